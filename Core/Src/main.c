@@ -24,6 +24,9 @@
 /* USER CODE BEGIN Includes */
 #include "dwt.h"
 #include "ds18b20.h"
+#include "ds18b20_acq.h"
+#include "ds18b20_ring.h"
+#include "ds18b20_snap.h"
 #include "onewire.h"
 /* USER CODE END Includes */
 
@@ -31,6 +34,8 @@
 /* USER CODE BEGIN PTD */
 DS18B20_Drv_t DS;
 OneWire_t OW;
+DS18B20_Acq_t Acq;
+DS18B20_Snap_t Snap;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
@@ -45,6 +50,12 @@ OneWire_t OW;
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+DS18B20_POOL(DS_Pool, DS18B20_POOL_DEFAULT);
+DS18B20_Ring_t DS_Rings[DS18B20_POOL_DEFAULT];
+DS18B20_SNAP_POOL(Snap_Pool, DS18B20_POOL_DEFAULT);
+#ifdef ONEWIRE_PROFILE
+OneWire_Prof_t Prof;
+#endif
 
 /* USER CODE END PV */
 
@@ -99,9 +110,29 @@ int main(void)
   OW.DataPin = DS_Pin;
   OW.DataPort = DS_GPIO_Port;
   DS.Resolution = DS18B20_Resolution_12bits;
+  DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+  /* Timestamped history of every probe, drained with DS18B20_Ring_Read by
+   * the logging or control task */
+  DS18B20_Ring_Attach(&DS, DS_Rings, DS18B20_POOL_DEFAULT);
+#ifdef ONEWIRE_PROFILE
+  /* Bus operation statistics, dumped over ITM every 10 s */
+  OneWire_Prof_Init(&OW, &Prof);
+#endif
   DS18B20_Init(&DS, &OW);
   /* Set high temperature alarm on device number 0, 31 Deg C */
-  DS18B20_SetTempAlarm(&OW, DS.DevAddr[0], 0, 31);
+  DS18B20_SetTempAlarm(&DS, &OW, 0, 0, 31);
+  /* Keep configuration over power cycles, one EEPROM copy per changed device */
+  DS18B20_Commit(&DS, &OW);
+  /* Sample every device once per second, one group per device so the
+   * conversion of one overlaps the read of the other */
+  DS18B20_Acq_Init(&Acq, 1000);
+  /* Look for plugged or unplugged probes every 5 s while the bus is idle */
+  Acq.Discovery = 5000;
+  DS18B20_Acq_AddBus(&Acq, &DS, &OW, DS18B20_POOL_DEFAULT);
+  /* All probes of a cycle at once, read with DS18B20_Snap_Read from any
+   * task or interrupt */
+  DS18B20_Snap_Init(&Snap, Snap_Pool, DS18B20_POOL_DEFAULT);
+  DS18B20_Acq_SetSnapshot(&Acq, &DS, &Snap);
 
   /* USER CODE END 2 */
 
@@ -112,20 +143,16 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-		/* Start temperature conversion on all devices on one bus */
-		DS18B20_StartAll(&OW);
-		/* Read temperature from device and store it to DS data structure */
-		for(uint8_t i = 0; i < OW.RomCnt; i++)
+		/* Start, read and search alarms, store in DS data structure. It's
+		 * recommanded to do not sample more than once per second */
+		if (!DS18B20_Acq_Process(&Acq))
 		{
-			/* Read Temperature */
-			DS18B20_Read(&OW, DS.DevAddr[i], &DS.Temperature[i]);
+			/* Nothing due, bus is idle */
+			HAL_Delay(1);
 		}
-
-		/* Search Alarm triggered and store in DS data structure */
-		DS18B20_AlarmSearch(&DS, &OW);
-
-		/* It's recommanded to do not more than once per second */
-		HAL_Delay(2000);
+#ifdef ONEWIRE_PROFILE
+		OneWire_Prof_Process(&OW, "DS", 10000);
+#endif
   }
   /* USER CODE END 3 */
 }
@@ -6,6 +6,8 @@
   ******************************************************************************
   */
 #include "ds18b20.h"
+#include "ds18b20_ring.h"
+#include <string.h>
 
 /**
   * @brief  The function is used to check valid DS18B20 ROM
@@ -18,6 +20,171 @@ uint8_t DS18B20_IsValid(uint8_t *ROM)
 	return (*ROM == DS18B20_FAMILY_CODE) ? 1 : 0;
 }
 
+/**
+  * @brief  The internal function is used to pack a ROM number into its key
+  * @retval ROM key
+  * @param  ROM		Pointer to ROM number
+  */
+static uint64_t DS18B20_Key(const uint8_t *ROM)
+{
+	uint64_t key;
+
+	memcpy(&key, ROM, 8);
+	return key;
+}
+
+/**
+  * @brief  The internal function is used to move devices inside the registry
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  Dst		Destination index
+  * @param  Src		Source index
+  * @param  Cnt		Number of devices
+  */
+static void DS18B20_Move(DS18B20_Drv_t *DS, uint16_t Dst, uint16_t Src,
+		uint16_t Cnt)
+{
+	memmove(&DS->Rom[Dst], &DS->Rom[Src], Cnt * sizeof(DS->Rom[0]));
+	memmove(&DS->Stamp[Dst], &DS->Stamp[Src], Cnt * sizeof(DS->Stamp[0]));
+	memmove(&DS->ConvEnd[Dst], &DS->ConvEnd[Src],
+			Cnt * sizeof(DS->ConvEnd[0]));
+	memmove(&DS->Temperature[Dst], &DS->Temperature[Src],
+			Cnt * sizeof(DS->Temperature[0]));
+	memmove(&DS->Ring[Dst], &DS->Ring[Src], Cnt * sizeof(DS->Ring[0]));
+	memmove(&DS->Status[Dst], &DS->Status[Src], Cnt * sizeof(DS->Status[0]));
+	memmove(&DS->VerifyCnt[Dst], &DS->VerifyCnt[Src],
+			Cnt * sizeof(DS->VerifyCnt[0]));
+	memmove(&DS->Config[Dst], &DS->Config[Src], Cnt * sizeof(DS->Config[0]));
+
+	/* Index of the last start is stale */
+	if (DS->PollIdx != DS18B20_POLL_ALL) DS->PollIdx = DS18B20_POLL_NONE;
+}
+
+/**
+  * @brief  The function is used to give the registry its storage, the pool
+  * 		is split into one dense array per device field
+  * @retval Number of devices the pool holds
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Pool		Storage, 8 byte aligned, see DS18B20_POOL
+  * @param  PoolSize	Size of the storage in byte
+  */
+uint16_t DS18B20_SetPool(DS18B20_Drv_t *DS, void *Pool, uint32_t PoolSize)
+{
+	uint32_t size = PoolSize / DS18B20_DEV_SIZE;
+	uint8_t *p = Pool;
+
+	if (size > 0xFFFFU) size = 0xFFFFU;
+
+	/* Widest fields first, every array stays aligned */
+	DS->Rom = (uint64_t *)p;
+	p += size * sizeof(DS->Rom[0]);
+	DS->Stamp = (uint32_t *)p;
+	p += size * sizeof(DS->Stamp[0]);
+	DS->ConvEnd = (uint32_t *)p;
+	p += size * sizeof(DS->ConvEnd[0]);
+	DS->Temperature = (DS18B20_Temp_t *)p;
+	p += size * sizeof(DS->Temperature[0]);
+	DS->Ring = (uint16_t *)p;
+	p += size * sizeof(DS->Ring[0]);
+	DS->Status = p;
+	p += size;
+	DS->VerifyCnt = p;
+	p += size;
+	DS->Config = (uint8_t (*)[3])p;
+
+	DS->Size = (uint16_t)size;
+	DS->Cnt = 0;
+	DS->Dropped = 0;
+	DS->PollIdx = DS18B20_POLL_NONE;
+	return DS->Size;
+}
+
+/**
+  * @brief  The function is used to look up a device by ROM number, binary
+  * 		search on the ROM keys
+  * @retval Device index, -1 = not registered
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  ROM			Pointer to ROM number
+  */
+int32_t DS18B20_Find(DS18B20_Drv_t *DS, const uint8_t *ROM)
+{
+	uint64_t key = DS18B20_Key(ROM);
+	int32_t lo = 0, hi = (int32_t)DS->Cnt - 1, mid;
+
+	while (lo <= hi)
+	{
+		mid = (lo + hi) >> 1;
+		if (DS->Rom[mid] == key) return mid;
+		if (DS->Rom[mid] < key)
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return -1;
+}
+
+/**
+  * @brief  The function is used to register a device, keeping the ROM keys
+  * 		sorted. Indexes above the new device move up by one
+  * @retval Device index, -1 = pool full
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  ROM			Pointer to ROM number
+  */
+int32_t DS18B20_Add(DS18B20_Drv_t *DS, const uint8_t *ROM)
+{
+	uint64_t key = DS18B20_Key(ROM);
+	uint16_t lo = 0, hi = DS->Cnt, mid;
+
+	/* First key not below the new one */
+	while (lo < hi)
+	{
+		mid = (lo + hi) >> 1;
+		if (DS->Rom[mid] < key)
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < DS->Cnt && DS->Rom[lo] == key) return lo;
+
+	if (DS->Cnt >= DS->Size)
+	{
+		DS->Dropped++;
+		return -1;
+	}
+
+	DS18B20_Move(DS, lo + 1, lo, DS->Cnt - lo);
+	DS->Rom[lo] = key;
+	DS->Stamp[lo] = 0;
+	DS->ConvEnd[lo] = 0;
+	DS->Temperature[lo] = 0;
+	DS->Ring[lo] = DS18B20_RING_NONE;
+	DS->Status[lo] = 0;
+	DS->VerifyCnt[lo] = 0;
+	DS->Cnt++;
+	return lo;
+}
+
+/**
+  * @brief  The function is used to unregister a device. Indexes above it
+  * 		move down by one
+  * @retval status in OK = 1, Not registered = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  ROM			Pointer to ROM number
+  */
+uint8_t DS18B20_Remove(DS18B20_Drv_t *DS, const uint8_t *ROM)
+{
+	int32_t idx = DS18B20_Find(DS, ROM);
+
+	if (idx < 0) return 0;
+
+	DS18B20_Move(DS, idx, idx + 1, DS->Cnt - idx - 1);
+	DS->Cnt--;
+	return 1;
+}
+
 /**
   * @brief  The function is used to get resolution
   * @retval Return value in 9 - 12
@@ -30,6 +197,8 @@ uint8_t DS18B20_GetResolution(OneWire_t* OW, uint8_t *ROM) {
 	/* Check valid ROM */
 	if (!DS18B20_IsValid(ROM)) return 0;
 
+	OneWire_OS_Lock(OW);
+
 	/* Reset line */
 	OneWire_Reset(OW);
 
@@ -48,94 +217,468 @@ uint8_t DS18B20_GetResolution(OneWire_t* OW, uint8_t *ROM) {
 	/* 5th byte of scratchpad is configuration register */
 	conf = OneWire_ReadByte(OW);
 
+	OneWire_OS_Unlock(OW);
+
 	/* Return 9 - 12 value according to number of bits */
 	return ((conf & 0x60) >> 5) + 9;
 }
 
+/**
+  * @brief  The function is used to fill the shadow of a device with the TH,
+  * 		TL and configuration bytes read from its scratchpad
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Idx			Device index in registry
+  */
+uint8_t DS18B20_LoadConfig(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx)
+{
+	uint8_t data[9];
+
+	if (Idx >= DS->Cnt) return 0;
+	if (!DS18B20_ReadScratchpad(OW, DS18B20_ROM(DS, Idx), data, 9)) return 0;
+
+	memcpy(DS->Config[Idx], &data[2], 3);
+	DS->Status[Idx] |= DS18B20_STAT_CONFIG;
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to write TH, TL and configuration
+  * 		in one write scratchpad transaction, only when they differ from
+  * 		the shadow. The EEPROM is left to DS18B20_Commit
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Idx			Device index in registry, shadow loaded
+  * @param  Config		TH, TL and configuration
+  */
+static uint8_t DS18B20_WriteConfig(DS18B20_Drv_t *DS, OneWire_t *OW,
+		uint16_t Idx, const uint8_t *Config)
+{
+	uint8_t cmd[13];
+	uint8_t ok;
+
+	/* Nothing changed, no bus access */
+	if (memcmp(DS->Config[Idx], Config, 3) == 0) return 1;
+
+	/* Select ROM number and write scratchpad in one transfer, only th, tl
+	 * and conf register can be written */
+	cmd[0] = ONEWIRE_CMD_MATCHROM;
+	memcpy(&cmd[1], DS18B20_ROM(DS, Idx), 8);
+	cmd[9] = DS18B20_CMD_WRITESCRATCHPAD;
+	memcpy(&cmd[10], Config, 3);
+
+	/* Reset line, no presence pulse means no device */
+	OneWire_OS_Lock(OW);
+	ONEWIRE_PROF_BEGIN(OW, prof);
+	if (OneWire_Reset(OW))
+	{
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+		OneWire_OS_Unlock(OW);
+		return 0;
+	}
+	ok = (OneWire_Xfer(OW, cmd, 13, NULL, 0) == HAL_OK) ? 1 : 0;
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+	OneWire_OS_Unlock(OW);
+	if (!ok) return 0;
+
+	memcpy(DS->Config[Idx], Config, 3);
+	DS->Status[Idx] |= DS18B20_STAT_DIRTY;
+	return 1;
+}
+
+/**
+  * @brief  The function is used to set resolution and temperature alarm
+  * 		range of a device together, one write when anything changed
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Idx			Device index in registry
+  * @param  Resolution	Resolution in 9 - 12
+  * @param  Low			Low temperature alarm, value > -55, 0 = reset
+  * @param  High		High temperature alarm, value < 125, 0 = reset
+  */
+uint8_t DS18B20_SetConfig(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx,
+		DS18B20_Res_t Resolution, int8_t Low, int8_t High)
+{
+	uint8_t cfg[3];
+
+	/* Check if device is registered DS18B20 */
+	if (Idx >= DS->Cnt || !DS18B20_IsValid(DS18B20_ROM(DS, Idx))) return 0;
+	if (!(DS->Status[Idx] & DS18B20_STAT_CONFIG) &&
+			!DS18B20_LoadConfig(DS, OW, Idx))
+	{
+		return 0;
+	}
+
+	Low = ((Low < -55) || (Low == 0)) ? -55 : Low;
+	High = ((High > 125) || (High == 0)) ? 125 : High;
+
+	cfg[0] = (uint8_t)High;
+	cfg[1] = (uint8_t)Low;
+	cfg[2] = DS->Config[Idx][2];
+	if (Resolution >= DS18B20_Resolution_9bits &&
+			Resolution <= DS18B20_Resolution_12bits)
+	{
+		cfg[2] &= ~((1 << DS18B20_RESOLUTION_R1) | (1 << DS18B20_RESOLUTION_R0));
+		cfg[2] |= (Resolution - DS18B20_Resolution_9bits) <<
+				DS18B20_RESOLUTION_R0;
+	}
+
+	return DS18B20_WriteConfig(DS, OW, Idx, cfg);
+}
+
 /**
   * @brief  The function is used as set resolution
   * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
   * @param  OW			OneWire HandleTypedef
-  * @param  ROM			Pointer to ROM number
+  * @param  Idx			Device index in registry
   * @param  Resolution	Resolution in 9 - 12
   */
-uint8_t DS18B20_SetResolution(OneWire_t* OW, uint8_t *ROM,
+uint8_t DS18B20_SetResolution(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx,
 		DS18B20_Res_t Resolution)
 {
-	uint8_t th, tl, conf;
+	uint8_t cfg[3];
 
-	/* Check valid ROM */
-	if (!DS18B20_IsValid(ROM)) return 0;
+	/* Check if device is registered DS18B20 */
+	if (Idx >= DS->Cnt || !DS18B20_IsValid(DS18B20_ROM(DS, Idx))) return 0;
+	if (Resolution < DS18B20_Resolution_9bits ||
+			Resolution > DS18B20_Resolution_12bits)
+	{
+		return 0;
+	}
+	if (!(DS->Status[Idx] & DS18B20_STAT_CONFIG) &&
+			!DS18B20_LoadConfig(DS, OW, Idx))
+	{
+		return 0;
+	}
 
-	/* Reset line */
-	OneWire_Reset(OW);
+	memcpy(cfg, DS->Config[Idx], 3);
+	cfg[2] &= ~((1 << DS18B20_RESOLUTION_R1) | (1 << DS18B20_RESOLUTION_R0));
+	cfg[2] |= (Resolution - DS18B20_Resolution_9bits) << DS18B20_RESOLUTION_R0;
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+	return DS18B20_WriteConfig(DS, OW, Idx, cfg);
+}
 
-	/* Read scratchpad command by onewire protocol */
-	OneWire_WriteByte(OW, DS18B20_CMD_READSCRATCHPAD);
+/**
+  * @brief  The function is used to write the same resolution and alarm range
+  * 		to every device with one Skip ROM write scratchpad. With Verify
+  * 		the devices whose shadow differed are read back, without the
+  * 		shadow takes the new values and the next full read checks it.
+  * 		Skip ROM also reaches other families, use on DS18B20 only buses
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Resolution	Resolution in 9 - 12
+  * @param  Low			Low temperature alarm, value > -55, 0 = reset
+  * @param  High		High temperature alarm, value < 125, 0 = reset
+  * @param  Verify		Read back changed devices = 1, Trust the write = 0
+  */
+uint8_t DS18B20_SetConfigAll(DS18B20_Drv_t *DS, OneWire_t *OW,
+		DS18B20_Res_t Resolution, int8_t Low, int8_t High, uint8_t Verify)
+{
+	uint8_t cmd[5], data[9];
+	uint8_t ok = 1;
+	uint16_t i;
 
-	/* Ignore first 2 bytes */
-	OneWire_ReadByte(OW);
-	OneWire_ReadByte(OW);
+	if (Resolution < DS18B20_Resolution_9bits ||
+			Resolution > DS18B20_Resolution_12bits)
+	{
+		return 0;
+	}
 
-	th = OneWire_ReadByte(OW);
-	tl = OneWire_ReadByte(OW);
-	conf = OneWire_ReadByte(OW);
+	Low = ((Low < -55) || (Low == 0)) ? -55 : Low;
+	High = ((High > 125) || (High == 0)) ? 125 : High;
 
-	if (Resolution == DS18B20_Resolution_9bits) {
-		conf &= ~(1 << DS18B20_RESOLUTION_R1);
-		conf &= ~(1 << DS18B20_RESOLUTION_R0);
-	} else if (Resolution == DS18B20_Resolution_10bits) {
-		conf &= ~(1 << DS18B20_RESOLUTION_R1);
-		conf |= 1 << DS18B20_RESOLUTION_R0;
-	} else if (Resolution == DS18B20_Resolution_11bits) {
-		conf |= 1 << DS18B20_RESOLUTION_R1;
-		conf &= ~(1 << DS18B20_RESOLUTION_R0);
-	} else if (Resolution == DS18B20_Resolution_12bits) {
-		conf |= 1 << DS18B20_RESOLUTION_R1;
-		conf |= 1 << DS18B20_RESOLUTION_R0;
+	cmd[0] = ONEWIRE_CMD_SKIPROM;
+	cmd[1] = DS18B20_CMD_WRITESCRATCHPAD;
+	cmd[2] = (uint8_t)High;
+	cmd[3] = (uint8_t)Low;
+	cmd[4] = 0x1F | ((Resolution - DS18B20_Resolution_9bits) <<
+			DS18B20_RESOLUTION_R0);
+	DS->Resolution = Resolution;
+
+	/* Devices to check are the ones not known to hold the values */
+	for (i = 0; i < DS->Cnt; i++)
+	{
+		if (!(DS->Status[i] & DS18B20_STAT_CONFIG) ||
+				memcmp(DS->Config[i], &cmd[2], 3) != 0)
+		{
+			break;
+		}
 	}
+	if (i == DS->Cnt) return 1;
 
-	/* Reset line */
-	OneWire_Reset(OW);
+	/* Reset line, no presence pulse means no device */
+	OneWire_OS_Lock(OW);
+	ONEWIRE_PROF_BEGIN(OW, prof);
+	if (OneWire_Reset(OW))
+	{
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+		OneWire_OS_Unlock(OW);
+		return 0;
+	}
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+	/* Write scratchpad of all connected devices in one transfer */
+	if (OneWire_Xfer(OW, cmd, 5, NULL, 0) != HAL_OK)
+	{
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+		OneWire_OS_Unlock(OW);
+		return 0;
+	}
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
 
-	/* Write scratchpad command by onewire protocol, only th, tl and conf
-	 * register can be written */
-	OneWire_WriteByte(OW, DS18B20_CMD_WRITESCRATCHPAD);
+	for (; i < DS->Cnt; i++)
+	{
+		if ((DS->Status[i] & DS18B20_STAT_CONFIG) &&
+				memcmp(DS->Config[i], &cmd[2], 3) == 0)
+		{
+			continue;
+		}
 
-	/* Write bytes */
-	OneWire_WriteByte(OW, th);
-	OneWire_WriteByte(OW, tl);
-	OneWire_WriteByte(OW, conf);
+		DS->Status[i] |= DS18B20_STAT_CONFIG | DS18B20_STAT_DIRTY;
+		if (!Verify)
+		{
+			memcpy(DS->Config[i], &cmd[2], 3);
+			continue;
+		}
 
-	/* Reset line */
-	OneWire_Reset(OW);
+		/* Read back up to configuration, without CRC a missing device
+		 * reads 0xFF and fails the compare */
+		if (DS18B20_ReadScratchpad(OW, DS18B20_ROM(DS, i), data, 5))
+		{
+			memcpy(DS->Config[i], &data[2], 3);
+		}
+		if (memcmp(DS->Config[i], &cmd[2], 3) != 0)
+		{
+			DS->Status[i] &= ~DS18B20_STAT_CONFIG;
+			ok = 0;
+		}
+	}
+	OneWire_OS_Unlock(OW);
+	return ok;
+}
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+/**
+  * @brief  The function is used to copy the scratchpad of every device
+  * 		changed since the last commit to its EEPROM, one device after
+  * 		the other as each copy takes up to 10 ms
+  * @retval Devices committed
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  */
+uint16_t DS18B20_Commit(DS18B20_Drv_t *DS, OneWire_t *OW)
+{
+	uint32_t tickstart;
+	uint16_t cnt = 0;
+
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		if (!(DS->Status[i] & DS18B20_STAT_DIRTY)) continue;
+
+		/* Reset line, no presence pulse means no device */
+		OneWire_OS_Lock(OW);
+		ONEWIRE_PROF_BEGIN(OW, prof);
+		if (OneWire_Reset(OW))
+		{
+			ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+			OneWire_OS_Unlock(OW);
+			continue;
+		}
+
+		/* Select ROM number */
+		OneWire_SelectWithPointer(OW, DS18B20_ROM(DS, i));
+
+		/* Copy scratchpad to EEPROM of DS18B20 */
+		OneWire_WriteByte(OW, DS18B20_CMD_COPYSCRATCHPAD);
+
+		if (DS->Parasite)
+		{
+			/* Device runs from the line, hold it high for the copy */
+			OneWire_StrongPullup(OW, 1);
+			OneWire_OS_Delay(DS18B20_COPY_TIMEOUT);
+			OneWire_StrongPullup(OW, 0);
+		} else {
+			/* Line is held low until the copy is done */
+			tickstart = HAL_GetTick();
+			while(!OneWire_ReadBit(OW)) {
+				if ((HAL_GetTick() - tickstart) > DS18B20_COPY_TIMEOUT) break;
+				OneWire_OS_Yield();
+			}
+		}
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Config);
+		OneWire_OS_Unlock(OW);
 
-	/* Copy scratchpad to EEPROM of DS18B20 */
-	OneWire_WriteByte(OW, DS18B20_CMD_COPYSCRATCHPAD);
+		DS->Status[i] &= ~DS18B20_STAT_DIRTY;
+		cnt++;
+	}
+	return cnt;
+}
+
+/**
+  * @brief  The function is used to get the conversion time
+  * @retval Conversion time in millisecond, rounded up
+  * @param  Resolution	Resolution in 9 - 12
+  */
+uint32_t DS18B20_ConvTime(DS18B20_Res_t Resolution)
+{
+	uint8_t shift = DS18B20_Resolution_12bits - Resolution;
 
+	/* 93.75, 187.5, 375, 750 ms */
+	if (Resolution < DS18B20_Resolution_9bits) shift = 3;
+	return (DS18B20_CONV_TIME_12BIT + (1U << shift) - 1) >> shift;
+}
+
+/**
+  * @brief  The internal function is used to get the resolution of a device,
+  * 		from its shadow once loaded, else the one of the bus
+  * @retval Resolution in 9 - 12
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Idx			Device index in registry
+  */
+static DS18B20_Res_t DS18B20_DevRes(DS18B20_Drv_t *DS, uint16_t Idx)
+{
+	if (DS->Status[Idx] & DS18B20_STAT_CONFIG)
+	{
+		return (DS18B20_Res_t)(((DS->Config[Idx][2] & 0x60) >> 5) + 9);
+	}
+	return DS->Resolution;
+}
+
+/**
+  * @brief  The internal function is used to record the conversion deadline
+  * 		of a device
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Idx			Device index in registry
+  * @param  Now			Tick at conversion start
+  */
+static void DS18B20_SetDeadline(DS18B20_Drv_t *DS, uint16_t Idx, uint32_t Now)
+{
+	DS->ConvEnd[Idx] = Now + DS18B20_ConvTime(DS18B20_DevRes(DS, Idx));
+	DS->Status[Idx] |= DS18B20_STAT_BUSY;
+}
+
+/**
+  * @brief  The internal function is used to wait for a conversion just
+  * 		started. A parasite bus holds the strong pull-up, switched on
+  * 		right after the command byte, until the deadline and releases
+  * 		it, an externally powered bus is left to read slot polling
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Idx			Device index started, DS18B20_POLL_ALL = all
+  */
+static void DS18B20_Convert(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx)
+{
+	uint32_t hold, t;
+
+	if (DS->Parasite)
+	{
+		/* Until the slowest device started is done */
+		hold = DS18B20_ConvTime(DS->Resolution);
+		if (Idx == DS18B20_POLL_ALL && DS->Cnt > 0)
+		{
+			hold = 0;
+			for (uint16_t i = 0; i < DS->Cnt; i++)
+			{
+				t = DS18B20_ConvTime(DS18B20_DevRes(DS, i));
+				if (t > hold) hold = t;
+			}
+		} else if (Idx < DS->Cnt) {
+			hold = DS18B20_ConvTime(DS18B20_DevRes(DS, Idx));
+		}
+
+		/* Pull-up is on since the command byte, no other bus access */
+		OneWire_OS_Delay(hold);
+		OneWire_StrongPullup(OW, 0);
+		DS->PollIdx = DS18B20_POLL_NONE;
+		return;
+	}
+
+	/* Read slots answer 0 until converted while no reset follows */
+	DS->PollIdx = Idx;
+	DS->PollMark = OW->Resets;
+}
+
+/**
+  * @brief  The internal function is used to check the conversion of the
+  * 		devices started last with one read slot, the deadline moves up
+  * 		when they are done. Only valid while the bus had no reset since
+  * @retval Done = 1, Converting or not known = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  */
+static uint8_t DS18B20_Poll(DS18B20_Drv_t *DS, OneWire_t *OW)
+{
+	uint32_t now;
+	uint8_t done = 0;
+
+	OneWire_OS_Lock(OW);
+	if (DS->PollIdx != DS18B20_POLL_NONE && DS->PollMark == OW->Resets)
+	{
+		done = OneWire_ReadBit(OW);
+	}
+	OneWire_OS_Unlock(OW);
+	if (!done) return 0;
+
+	now = HAL_GetTick();
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		if (DS->PollIdx != DS18B20_POLL_ALL && DS->PollIdx != i) continue;
+		if ((DS->Status[i] & DS18B20_STAT_BUSY) &&
+				(int32_t)(now - DS->ConvEnd[i]) < 0)
+		{
+			DS->ConvEnd[i] = now;
+		}
+	}
+	DS->PollIdx = DS18B20_POLL_NONE;
 	return 1;
 }
 
+/**
+  * @brief  The function is used to read the power supply of the devices
+  * 		with Skip ROM, any parasite powered device pulls the slot low
+  * @retval Parasite powered device on bus = 1, All external = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  */
+uint8_t DS18B20_ReadPowerSupply(DS18B20_Drv_t *DS, OneWire_t *OW)
+{
+	DS->Parasite = 0;
+
+	/* Reset line, no presence pulse means no device */
+	OneWire_OS_Lock(OW);
+	if (!OneWire_Reset(OW))
+	{
+		/* Skip rom */
+		OneWire_WriteByte(OW, ONEWIRE_CMD_SKIPROM);
+
+		/* Read power supply, parasite powered devices answer 0 */
+		OneWire_WriteByte(OW, DS18B20_CMD_READPOWER);
+		DS->Parasite = OneWire_ReadBit(OW) ? 0 : 1;
+	}
+	OneWire_OS_Unlock(OW);
+
+	return DS->Parasite;
+}
+
 /**
   * @brief  The function is used as start selected ROM device
-  * @retval status in OK = 1, Failed = 0
+  * @retval status in OK = 0, Failed = 1
+  * @param  DS			DS18B20 HandleTypedef
   * @param  OW			OneWire HandleTypedef
   * @param  ROM			Pointer to ROM number
   */
-uint8_t DS18B20_Start(OneWire_t* OW, uint8_t *ROM)
+uint8_t DS18B20_Start(DS18B20_Drv_t *DS, OneWire_t* OW, uint8_t *ROM)
 {
+	int32_t idx;
+
 	/* Check if device is DS18B20 */
 	if(!DS18B20_IsValid(ROM)) return 1;
 
+	OneWire_OS_Lock(OW);
+
 	/* Reset line */
 	OneWire_Reset(OW);
 
@@ -144,16 +687,29 @@ uint8_t DS18B20_Start(OneWire_t* OW, uint8_t *ROM)
 
 	/* Start temperature conversion */
 	OneWire_WriteByte(OW, DS18B20_CMD_CONVERT);
+	if (DS->Parasite) OneWire_StrongPullup(OW, 1);
+
+	/* Record deadline of the device */
+	idx = DS18B20_Find(DS, ROM);
+	if (idx >= 0) DS18B20_SetDeadline(DS, idx, HAL_GetTick());
+	DS18B20_Convert(DS, OW, (idx >= 0) ? (uint16_t)idx : DS18B20_POLL_NONE);
+
+	OneWire_OS_Unlock(OW);
 
 	return 0;
 }
 
 /**
   * @brief  The function is used as start all ROM device
+  * @param  DS			DS18B20 HandleTypedef
   * @param  OW			OneWire HandleTypedef
   */
-void DS18B20_StartAll(OneWire_t* OW)
+void DS18B20_StartAll(DS18B20_Drv_t *DS, OneWire_t* OW)
 {
+	uint32_t now;
+
+	OneWire_OS_Lock(OW);
+
 	/* Reset pulse */
 	OneWire_Reset(OW);
 
@@ -162,208 +718,477 @@ void DS18B20_StartAll(OneWire_t* OW)
 
 	/* Start conversion on all connected devices */
 	OneWire_WriteByte(OW, DS18B20_CMD_CONVERT);
+	if (DS->Parasite) OneWire_StrongPullup(OW, 1);
+
+	/* Record deadline of all devices */
+	now = HAL_GetTick();
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		DS18B20_SetDeadline(DS, i, now);
+	}
+	DS18B20_Convert(DS, OW, DS18B20_POLL_ALL);
+
+	OneWire_OS_Unlock(OW);
 }
 
 /**
-  * @brief  The function is used as read bit from device and store in selected
-  * 		destination
-  * @retval status in OK = 1, Failed = 0
-  * @param  OW				OneWire HandleTypedef
-  * @param  ROM				Pointer to ROM number
-  * @param  Destination		Pointer to return value
+  * @brief  The function is used to check if the conversion of a device is
+  * 		done, without bus access
+  * @retval Ready = 1, Converting = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Idx			Device index in registry
   */
-uint8_t DS18B20_Read(OneWire_t* OW, uint8_t *ROM, float *Destination)
+uint8_t DS18B20_IsReady(DS18B20_Drv_t *DS, uint16_t Idx)
 {
-	uint16_t temperature;
-	uint8_t resolution;
-	int8_t digit, minus = 0;
-	float decimal;
-	uint8_t i = 0;
-	uint8_t data[9];
-	uint8_t crc;
-
-	/* Check if device is DS18B20 */
-	if (!DS18B20_IsValid(ROM)) return 0;
+	if (!(DS->Status[Idx] & DS18B20_STAT_BUSY)) return 1;
 
-	/* Wait until line is released, then coversion is completed */
-	while(!OneWire_ReadBit(OW)) {};
-
-	/* Reset line */
-	OneWire_Reset(OW);
+	return ((int32_t)(HAL_GetTick() - DS->ConvEnd[Idx]) >= 0) ? 1 : 0;
+}
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+#ifdef DS18B20_CHECK_FIXED
+/**
+  * @brief  The internal function is used to check the fixed scratchpad bits
+  * 		while it is read, a wrong one aborts the read before the CRC
+  * @retval Byte OK = 1, Corrupt = 0
+  * @param  Idx		Byte index in scratchpad
+  * @param  Byte	Byte read
+  */
+static uint8_t DS18B20_CheckScratchpad(uint8_t Idx, uint8_t Byte)
+{
+	switch (Idx)
+	{
+		case 4:	return ((Byte & 0x9F) == 0x1F) ? 1 : 0;
+		case 5:	return (Byte == 0xFF) ? 1 : 0;
+		case 7:	return (Byte == 0x10) ? 1 : 0;
+		default: return 1;
+	}
+}
+#define DS18B20_SCRATCH_CHECK		DS18B20_CheckScratchpad
+#else
+#define DS18B20_SCRATCH_CHECK		NULL
+#endif /* DS18B20_CHECK_FIXED */
 
-	/* Read scratchpad command by onewire protocol */
-	OneWire_WriteByte(OW, DS18B20_CMD_READSCRATCHPAD);
+/**
+  * @brief  The function is used to read a scratchpad, the CRC is
+  * 		checked as the bytes come in. A short read stops after the
+  * 		temperature and has no CRC
+  * @retval status in OK = 1, Failed = 0
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		Pointer to ROM number
+  * @param  data	Scratchpad, 9 bytes
+  * @param  Len		Number of bytes to read, 2 or 9
+  */
+uint8_t DS18B20_ReadScratchpad(OneWire_t* OW, uint8_t *ROM,
+		uint8_t *data, uint8_t Len)
+{
+	uint8_t cmd[10];
+	uint8_t ok = 1;
 
-	/* Get data */
-	for (i = 0; i < 9; i++) {
-		/* Read byte by byte */
-		data[i] = OneWire_ReadByte(OW);
+	/* Select ROM number and read scratchpad in one transfer */
+	cmd[0] = ONEWIRE_CMD_MATCHROM;
+	for (uint8_t i = 0; i < 8; i++) {
+		cmd[i + 1] = ROM[i];
 	}
+	cmd[9] = DS18B20_CMD_READSCRATCHPAD;
 
-	/* Calculate CRC */
-	crc = OneWire_CRC8(data, 8);
-
-	/* Check if CRC is ok */
-	if (crc != data[8]) {
-		/* CRC invalid */
+	/* Reset line, no presence pulse means no device */
+	OneWire_OS_Lock(OW);
+	ONEWIRE_PROF_BEGIN(OW, prof);
+	if (OneWire_Reset(OW))
+	{
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Scratchpad);
+		OneWire_OS_Unlock(OW);
 		return 0;
 	}
 
-	/* First two bytes of scratchpad are temperature values */
-	temperature = data[0] | (data[1] << 8);
+	if (Len < 9)
+	{
+		ok = (OneWire_Xfer(OW, cmd, 10, data, Len) == HAL_OK) ? 1 : 0;
+	} else {
+		ok = OneWire_XferCRC(OW, cmd, 10, data, 9, DS18B20_SCRATCH_CHECK);
+	}
 
-	/* Reset line */
+	/* Reset line, also ends a short or aborted read */
 	OneWire_Reset(OW);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Scratchpad);
+	OneWire_OS_Unlock(OW);
 
-	/* Check if temperature is negative */
-	if (temperature & 0x8000) {
-		/* Two's complement, temperature is negative */
-		temperature = ~temperature + 1;
-		minus = 1;
-	}
-
-	/* Get sensor resolution */
-	resolution = ((data[4] & 0x60) >> 5) + 9;
-
-	/* Store temperature integer digits and decimal digits */
-	digit = temperature >> 4;
-	digit |= ((temperature >> 8) & 0x7) << 4;
-
-	/* Store decimal digits */
-	switch (resolution) {
-		case 9: {
-			decimal = (temperature >> 3) & 0x01;
-			decimal *= (float)DS18B20_DECIMAL_STEPS_9BIT;
-		} break;
-		case 10: {
-			decimal = (temperature >> 2) & 0x03;
-			decimal *= (float)DS18B20_DECIMAL_STEPS_10BIT;
-		} break;
-		case 11: {
-			decimal = (temperature >> 1) & 0x07;
-			decimal *= (float)DS18B20_DECIMAL_STEPS_11BIT;
-		} break;
-		case 12: {
-			decimal = temperature & 0x0F;
-			decimal *= (float)DS18B20_DECIMAL_STEPS_12BIT;
-		} break;
-		default: {
-			decimal = 0xFF;
-			digit = 0;
-		}
-	}
+	return ok;
+}
+
+/**
+  * @brief  The internal function is used to decode the temperature of a
+  * 		checked scratchpad, bits undefined at the resolution are cleared
+  * @retval Temperature in 1/16 degree Celsius
+  * @param  data			Scratchpad, temperature bytes at least
+  * @param  resolution		Resolution in 9 - 12
+  */
+static int16_t DS18B20_Decode(const uint8_t *data, uint8_t resolution)
+{
+	/* First two bytes of scratchpad are the sign extended temperature */
+	int16_t raw = (int16_t)(data[0] | (data[1] << 8));
 
-	/* Check for negative part */
-	decimal = digit + decimal;
-	if (minus) {
-		decimal = 0 - decimal;
+	if (resolution >= 9 && resolution < 12)
+	{
+		raw &= (int16_t)~((1 << (12 - resolution)) - 1);
 	}
+	return raw;
+}
 
-	/* Set to pointer */
-	*Destination = decimal;
+/**
+  * @brief  The function is used as read bit from device and store in selected
+  * 		destination
+  * @retval status in OK = 1, Failed = 0
+  * @param  OW				OneWire HandleTypedef
+  * @param  ROM				Pointer to ROM number
+  * @param  Destination		Pointer to return value
+  */
+uint8_t DS18B20_Read(OneWire_t* OW, uint8_t *ROM, float *Destination)
+{
+	int16_t raw;
+
+	if (!DS18B20_ReadRaw(OW, ROM, &raw)) return 0;
 
-	/* Return 1, temperature valid */
+	*Destination = (float)raw * 0.0625f;
 	return 1;
 }
 
 /**
-  * @brief  The function is used as set temperature alarm range on
-  * 		selected device
+  * @brief  The function is used as read the temperature without float math
   * @retval status in OK = 1, Failed = 0
   * @param  OW		OneWire HandleTypedef
   * @param  ROM		Pointer to ROM number
-  * @param  Low		Low temperature alarm, value > -55, 0 = reset
-  * @param  High	High temperature alarm,, value < 125, 0 = reset
+  * @param  Raw		Temperature in 1/16 degree Celsius
   */
-uint8_t DS18B20_SetTempAlarm(OneWire_t* OW, uint8_t *ROM, int8_t Low,
-		int8_t High)
+uint8_t DS18B20_ReadRaw(OneWire_t* OW, uint8_t *ROM, int16_t *Raw)
 {
-	uint8_t tl, th, conf;
+	uint32_t tickstart;
+	uint8_t data[9];
+	uint8_t ok;
 
 	/* Check if device is DS18B20 */
 	if (!DS18B20_IsValid(ROM)) return 0;
 
-	Low = ((Low < -55) || (Low == 0)) ? -55 : Low;
-	High = ((High > 125) || (High == 0)) ? 125 : High;
+	/* Wait until line is released, then coversion is completed */
+	OneWire_OS_Lock(OW);
+	tickstart = HAL_GetTick();
+	while(!OneWire_ReadBit(OW)) {
+		/* Device dropped off or stuck */
+		if ((HAL_GetTick() - tickstart) > DS18B20_READ_TIMEOUT)
+		{
+			OneWire_OS_Unlock(OW);
+			return 0;
+		}
+		OneWire_OS_Yield();
+	}
 
-	/* Reset line */
-	OneWire_Reset(OW);
+	/* Read and check scratchpad */
+	ok = DS18B20_ReadScratchpad(OW, ROM, data, 9);
+	OneWire_OS_Unlock(OW);
+	if (!ok) return 0;
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+	/* Resolution from configuration register */
+	*Raw = DS18B20_Decode(data, ((data[4] & 0x60) >> 5) + 9);
+	return 1;
+}
 
-	/* Read scratchpad command by onewire protocol */
-	OneWire_WriteByte(OW, DS18B20_CMD_READSCRATCHPAD);
+/**
+  * @brief  The function is used to convert raw temperatures to degree
+  * @param  Raw				Temperatures in 1/16 degree Celsius
+  * @param  Destination		Temperatures in degree Celsius
+  * @param  Cnt				Number of temperatures
+  */
+void DS18B20_RawToFloat(const int16_t *Raw, float *Destination, uint16_t Cnt)
+{
+	uint16_t i;
 
-	/* Ignore first 2 bytes */
-	OneWire_ReadByte(OW);
-	OneWire_ReadByte(OW);
+	for (i = 0; i < Cnt; i++)
+	{
+		Destination[i] = (float)Raw[i] * 0.0625f;
+	}
+}
 
-	th = OneWire_ReadByte(OW);
-	tl = OneWire_ReadByte(OW);
-	conf = OneWire_ReadByte(OW);
+/**
+  * @brief  The function is used to convert raw temperatures to 1/100 degree,
+  * 		rounded to nearest, integer only
+  * @param  Raw				Temperatures in 1/16 degree Celsius
+  * @param  Destination		Temperatures in 1/100 degree Celsius
+  * @param  Cnt				Number of temperatures
+  */
+void DS18B20_RawToCenti(const int16_t *Raw, int16_t *Destination,
+		uint16_t Cnt)
+{
+	uint16_t i;
+	int32_t t;
 
-	th = (uint8_t)High;
-	tl = (uint8_t)Low;
+	for (i = 0; i < Cnt; i++)
+	{
+		/* x 100 / 16 = x 25 / 4 */
+		t = (int32_t)Raw[i] * 25;
+		Destination[i] = (int16_t)((t + ((t < 0) ? -2 : 2)) / 4);
+	}
+}
 
-	/* Reset line */
-	OneWire_Reset(OW);
+/**
+  * @brief  The function is used to read a device once its conversion
+  * 		deadline has passed, the bus is not touched before. A sample
+  * 		or a timeout is pushed to the ring of the device, if any
+  * @retval HAL_OK temperature stored in DS->Temperature[Idx],
+  * 		HAL_BUSY still converting or read failed within Timeout,
+  * 		HAL_TIMEOUT read still failing Timeout ms after the deadline,
+  * 		HAL_ERROR invalid ROM
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Idx			Device index in registry
+  * @param  Timeout		Time in millisecond allowed after the deadline
+  */
+HAL_StatusTypeDef DS18B20_TryRead(DS18B20_Drv_t *DS, OneWire_t* OW,
+		uint16_t Idx, uint32_t Timeout)
+{
+	uint8_t data[9];
+	uint8_t full, ok;
+	int16_t raw = 0;
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+	/* Check if device is registered DS18B20 */
+	if (Idx >= DS->Cnt || !DS18B20_IsValid(DS18B20_ROM(DS, Idx)))
+	{
+		return HAL_ERROR;
+	}
 
-	/* Write scratchpad command by onewire protocol, only th, tl and conf
-	 * register can be written */
-	OneWire_WriteByte(OW, DS18B20_CMD_WRITESCRATCHPAD);
+	/* Before the deadline an externally powered bus may be done already */
+	if (!DS18B20_IsReady(DS, Idx) &&
+			(!DS18B20_Poll(DS, OW) || !DS18B20_IsReady(DS, Idx)))
+	{
+		return HAL_BUSY;
+	}
 
-	/* Write bytes */
-	OneWire_WriteByte(OW, th);
-	OneWire_WriteByte(OW, tl);
-	OneWire_WriteByte(OW, conf);
+	/* Integrity policy of the bus, the first read and the read after a
+	 * failure are full */
+	full = 1;
+	if (DS->Verify != DS18B20_Verify_Full)
+	{
+		full = (DS->VerifyCnt[Idx] == 0) ? 1 : 0;
+	}
 
-	/* Reset line */
-	OneWire_Reset(OW);
+	if (!full)
+	{
+		/* Short read, sign bits 15 - 11 of the temperature must agree. A
+		 * device gone from a shared bus leaves the line high, FF FF */
+		ok = DS18B20_ReadScratchpad(OW, DS18B20_ROM(DS, Idx), data, 2) &&
+				((data[1] & 0xF8) == 0x00 || (data[1] & 0xF8) == 0xF8) &&
+				(data[0] != 0xFF || data[1] != 0xFF);
+		if (ok)
+		{
+			raw = DS18B20_Decode(data, DS18B20_DevRes(DS, Idx));
+			if (DS->Verify == DS18B20_Verify_Periodic &&
+					++DS->VerifyCnt[Idx] >= DS->VerifyEvery)
+			{
+				DS->VerifyCnt[Idx] = 0;
+			}
+		}
+	} else {
+		ok = DS18B20_ReadScratchpad(OW, DS18B20_ROM(DS, Idx), data, 9);
+		if (ok)
+		{
+			raw = DS18B20_Decode(data, ((data[4] & 0x60) >> 5) + 9);
+			if (DS->Verify == DS18B20_Verify_Short || DS->VerifyEvery > 1)
+			{
+				DS->VerifyCnt[Idx] = 1;
+			}
+
+			/* Keep the shadow up to date for free */
+			memcpy(DS->Config[Idx], &data[2], 3);
+			DS->Status[Idx] |= DS18B20_STAT_CONFIG;
+		}
+	}
 
-	/* Select ROM number */
-	OneWire_SelectWithPointer(OW, ROM);
+	if (ok)
+	{
+		DS->Temperature[Idx] = DS18B20_TEMP(raw);
+		DS->Stamp[Idx] = HAL_GetTick();
+		DS->Status[Idx] = (DS->Status[Idx] & ~(DS18B20_STAT_BUSY |
+				DS18B20_STAT_FAULT)) | DS18B20_STAT_VALID;
+		DS18B20_Ring_Push(DS, Idx, DS->Stamp[Idx], raw, DS18B20_STAT_VALID |
+				(DS->Status[Idx] & DS18B20_STAT_ALARM));
+		return HAL_OK;
+	}
+	if (DS->Verify != DS18B20_Verify_Full) DS->Mismatch++;
 
-	/* Copy scratchpad to EEPROM of DS18B20 */
-	OneWire_WriteByte(OW, DS18B20_CMD_COPYSCRATCHPAD);
+	/* Next try is a full read */
+	DS->VerifyCnt[Idx] = 0;
 
-	return 1;
+	/* Device dropped off or disturbed line, retry until timeout. A read
+	 * slot cannot tell, only the device addressed last drives it */
+	if ((DS->Status[Idx] & DS18B20_STAT_BUSY) &&
+			(HAL_GetTick() - DS->ConvEnd[Idx]) < Timeout)
+	{
+		return HAL_BUSY;
+	}
+	DS->Status[Idx] = (DS->Status[Idx] & ~DS18B20_STAT_BUSY) |
+			DS18B20_STAT_FAULT;
+	DS18B20_Ring_Push(DS, Idx, HAL_GetTick(), 0, DS18B20_STAT_FAULT |
+			(DS->Status[Idx] & DS18B20_STAT_ALARM));
+	return HAL_TIMEOUT;
+}
+
+/**
+  * @brief  The function is used as set temperature alarm range on
+  * 		selected device
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  Idx		Device index in registry
+  * @param  Low		Low temperature alarm, value > -55, 0 = reset
+  * @param  High	High temperature alarm,, value < 125, 0 = reset
+  */
+uint8_t DS18B20_SetTempAlarm(DS18B20_Drv_t *DS, OneWire_t* OW, uint16_t Idx,
+		int8_t Low, int8_t High)
+{
+	/* Resolution out of range keeps the configuration register */
+	return DS18B20_SetConfig(DS, OW, Idx, (DS18B20_Res_t)0, Low, High);
 }
 
 /**
   * @brief  The function is used as search device that had temperature alarm
-  * 		triggered and store it in DS18B20 alarm data structure
+  * 		triggered and flag it with DS18B20_STAT_ALARM
   * @retval status of search, OK = 1, Failed = 0
   * @param  DS		DS18B20 HandleTypedef
   * @param  OW		OneWire HandleTypedef
   */
 uint8_t DS18B20_AlarmSearch(DS18B20_Drv_t *DS, OneWire_t* OW)
 {
+	uint8_t rom[8];
 	uint8_t t = 0;
+	int32_t idx;
 
 	/* Reset Alarm in DS */
-	for(uint8_t i = 0; i < DS18B20_MaxCnt; i++)
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		DS->Status[i] &= ~DS18B20_STAT_ALARM;
+	}
+
+	/* Start alarm search, the search state is kept between passes */
+	OneWire_OS_Lock(OW);
+	while (OneWire_Search(OW, DS18B20_CMD_ALARM_SEARCH))
+	{
+		/* Flag device which has alarm flag set, unknown ROM are skipped */
+		OneWire_GetDevRom(OW, rom);
+		idx = DS18B20_Find(DS, rom);
+		if (idx >= 0) DS->Status[idx] |= DS18B20_STAT_ALARM;
+		t = 1;
+	}
+	OneWire_OS_Unlock(OW);
+	return t;
+}
+
+/**
+  * @brief  The function is used as start all ROM device on all lines in mask
+  * @param  P			OneWire port HandleTypedef
+  * @param  Mask		Lines
+  */
+void DS18B20_Port_StartAll(OneWire_Port_t *P, uint16_t Mask)
+{
+	/* Reset pulse */
+	OneWire_Port_Reset(P, Mask);
+
+	/* Skip rom */
+	OneWire_Port_WriteByte(P, Mask, ONEWIRE_CMD_SKIPROM);
+
+	/* Start conversion on all connected devices */
+	OneWire_Port_WriteByte(P, Mask, DS18B20_CMD_CONVERT);
+}
+
+/**
+  * @brief  The function is used as read one device per line, all lines in
+  * 		mask together. Lines still busy after DS18B20_READ_TIMEOUT or
+  * 		without presence pulse are left out
+  * @retval Lines with valid temperature
+  * @param  P				OneWire port HandleTypedef
+  * @param  Mask			Lines
+  * @param  ROM				ROM number per pin number, 16 entries
+  * @param  Destination		Temperature per pin number, 16 entries
+  */
+uint16_t DS18B20_Port_Read(OneWire_Port_t *P, uint16_t Mask,
+		uint8_t ROM[][8], DS18B20_Temp_t *Destination)
+{
+	uint8_t cmd[ONEWIRE_PORT_LINES][10];
+	uint8_t data[ONEWIRE_PORT_LINES][9];
+	uint32_t tickstart;
+	uint16_t ok = 0, done;
+	uint8_t i, j;
+
+	/* Only lines with a DS18B20 take part */
+	Mask &= P->Pins;
+	for (i = 0; i < ONEWIRE_PORT_LINES; i++)
 	{
-		for(uint8_t j = 0; j < 8; j++)
+		if (!(Mask & (1U << i))) continue;
+		if (!DS18B20_IsValid(ROM[i]))
+		{
+			Mask &= ~(1U << i);
+			continue;
+		}
+
+		cmd[i][0] = ONEWIRE_CMD_MATCHROM;
+		for (j = 0; j < 8; j++)
 		{
-			DS->AlmAddr[i][j] = 0;
+			cmd[i][j + 1] = ROM[i][j];
 		}
+		cmd[i][9] = DS18B20_CMD_READSCRATCHPAD;
 	}
+	if (!Mask) return 0;
 
-	/* Start alarm search */
-	while (OneWire_Search(OW, DS18B20_CMD_ALARM_SEARCH))
+	/* Wait until all lines are released, then coversion is completed */
+	tickstart = HAL_GetTick();
+	while ((done = OneWire_Port_ReadBit(P, Mask) & Mask) != Mask)
+	{
+		/* Lines dropped off or stuck low are left out */
+		if ((HAL_GetTick() - tickstart) > DS18B20_READ_TIMEOUT)
+		{
+			Mask = done;
+			break;
+		}
+		OneWire_OS_Yield();
+	}
+
+	/* Lines without presence pulse are left out, the CRC alone passes a
+	 * line reading all zero */
+	Mask &= OneWire_Port_Reset(P, Mask);
+	if (!Mask) return 0;
+
+	/* Select ROM number and read scratchpad on all lines */
+	OneWire_Port_Xfer(P, Mask, &cmd[0][0], 10, &data[0][0], 9);
+	OneWire_Port_Reset(P, Mask);
+
+	for (i = 0; i < ONEWIRE_PORT_LINES; i++)
 	{
-		/* Store ROM of device which has alarm flag set */
-		OneWire_GetDevRom(OW, DS->AlmAddr[t]);
-		t++;
+		if ((Mask & (1U << i)) && OneWire_CRC8(data[i], 9) == 0)
+		{
+			Destination[i] = DS18B20_TEMP(DS18B20_Decode(data[i],
+					((data[i][4] & 0x60) >> 5) + 9));
+			ok |= 1U << i;
+		}
 	}
-	return (t > 0) ? 1 : 0;
+	return ok;
+}
+
+/**
+  * @brief  The function is used to set a newly found device to the bus
+  * 		resolution with the temperature alarm reset, the EEPROM is only
+  * 		written by DS18B20_Commit
+  * @retval status in OK = 1, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  ROM			Pointer to ROM number
+  */
+uint8_t DS18B20_Configure(DS18B20_Drv_t *DS, OneWire_t *OW, uint8_t *ROM)
+{
+	int32_t idx = DS18B20_Find(DS, ROM);
+
+	if (idx < 0) return 0;
+
+	/* Fresh shadow, then resolution and alarm reset in one write */
+	if (!DS18B20_LoadConfig(DS, OW, idx)) return 0;
+	return DS18B20_SetConfig(DS, OW, idx, DS->Resolution, 0, 0);
 }
 
 /**
@@ -375,26 +1200,36 @@ uint8_t DS18B20_AlarmSearch(DS18B20_Drv_t *DS, OneWire_t* OW)
   */
 uint8_t DS18B20_Init(DS18B20_Drv_t *DS, OneWire_t *OW)
 {
+	uint8_t rom[8];
+
 	/* Initialize OneWire and reset all data */
 	OneWire_Init(OW);
+	OneWire_OS_Lock(OW);
+	DS->Cnt = 0;
+	DS->Dropped = 0;
+
+	/* Conversion wait follows the power supply of the bus */
+	DS18B20_ReadPowerSupply(DS, OW);
 
-	/* Search all OneWire devices ROM */
+	/* Search DS18B20 ROM only, other families on the line are skipped */
+	OneWire_TargetSetup(OW, DS18B20_FAMILY_CODE);
 	while(1)
 	{
 		/* Start searching for OneWire devices along the line */
 		if(OneWire_Search(OW, ONEWIRE_CMD_SEARCHROM) != 1) break;
+		if(OW->RomByte[0] != DS18B20_FAMILY_CODE)
+		{
+			OneWire_ResetSearch(OW);
+			break;
+		}
 
-		/* Get device ROM */
-		OneWire_GetDevRom(OW, DS->DevAddr[OW->RomCnt]);
-
-		/* Set ROM Resolution */
-		DS18B20_SetResolution(OW, &OW->RomCnt, DS->Resolution);
-
-		/* Reset Temperature Alarm */
-		DS18B20_SetTempAlarm(OW, &OW->RomCnt, 0, 0);
+		/* Get device ROM, devices beyond the pool are counted only */
+		OneWire_GetDevRom(OW, rom);
+		if (DS18B20_Add(DS, rom) < 0) continue;
 
-		OW->RomCnt++;
+		DS18B20_Configure(DS, OW, rom);
 	}
+	OneWire_OS_Unlock(OW);
 
-	return (OW->RomCnt != 0) ? 1 : 0;
+	return (DS->Cnt != 0) ? 1 : 0;
 }
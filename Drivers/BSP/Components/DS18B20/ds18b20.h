@@ -7,6 +7,31 @@
   * @attention
   * Usage:
   *		Uncomment LL Driver for HAL driver
+  *		Define DS18B20_FIXED_POINT to store temperatures as 1/16 degree
+  *		int16_t, 2 bytes per sensor and no float math in the read path
+  *		Define DS18B20_CHECK_FIXED to abort a full scratchpad read on a
+  *		wrong fixed byte (4, 5, 7) before the CRC, some compatible parts
+  *		differ there. Without it only the CRC is checked
+  *
+  *		Devices live in a pool given by the application, sized for the
+  *		number of sensors expected on the bus:
+  *
+  *		DS18B20_POOL(DS_Pool, 300);
+  *		DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+  *		DS18B20_Init(&DS, &OW);
+  *
+  *		TH, TL and configuration are kept in a shadow per device, setters
+  *		without a change do not touch the bus and only write the
+  *		scratchpad. DS18B20_Commit copies changed devices to EEPROM:
+  *
+  *		DS18B20_SetTempAlarm(&DS, &OW, 0, 0, 31);
+  *		DS18B20_Commit(&DS, &OW);
+  *
+  *		DS18B20_Init checks the power supply of the bus. On a parasite
+  *		powered bus the line is held high with OneWire_StrongPullup while
+  *		converting, DS18B20_Start and DS18B20_StartAll return when the
+  *		conversion is done. On an externally powered bus they return at
+  *		once and DS18B20_TryRead polls read slots to finish early.
   *
   ******************************************************************************
   */
@@ -21,9 +46,14 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "onewire.h"
+#include "onewire_port.h"
 
 /* Data Structure ------------------------------------------------------------*/
-#define DS18B20_MaxCnt		2
+/* Sensors in the pools of Core/Src/main.c and owsim, see DS18B20_POOL. The
+ * driver has no compile-time limit, the pool given to DS18B20_SetPool is */
+#ifndef DS18B20_POOL_DEFAULT
+#define DS18B20_POOL_DEFAULT		2
+#endif
 
 /* Register ------------------------------------------------------------------*/
 #define DS18B20_CMD_CONVERT				0x44
@@ -31,6 +61,7 @@
 #define DS18B20_CMD_READSCRATCHPAD		0xBE
 #define DS18B20_CMD_WRITESCRATCHPAD		0x4E
 #define DS18B20_CMD_COPYSCRATCHPAD		0x48
+#define DS18B20_CMD_READPOWER			0xB4
 /* Data Structure ------------------------------------------------------------*/
 #define DS18B20_FAMILY_CODE				0x28
 
@@ -43,6 +74,27 @@
 #define DS18B20_DECIMAL_STEPS_10BIT		0.25
 #define DS18B20_DECIMAL_STEPS_9BIT		0.5
 
+/* Conversion time (ms) at 12 bits, halved per bit below */
+#define DS18B20_CONV_TIME_12BIT			750
+
+/* Time (ms) DS18B20_Read waits for a conversion before giving up */
+#define DS18B20_READ_TIMEOUT			(DS18B20_CONV_TIME_12BIT + 250)
+
+/* Time (ms) DS18B20_Commit waits for a copy to EEPROM, the strong pull-up
+ * hold of a parasite bus */
+#define DS18B20_COPY_TIMEOUT			10
+
+
+/* Stored temperature, raw 1/16 degree Celsius or degree Celsius */
+#ifdef DS18B20_FIXED_POINT
+typedef int16_t DS18B20_Temp_t;
+#define DS18B20_TEMP(Raw)				(Raw)
+#define DS18B20_TEMP_FLOAT(Temp)		((float)(Temp) * 0.0625f)
+#else
+typedef float DS18B20_Temp_t;
+#define DS18B20_TEMP(Raw)				((float)(Raw) * 0.0625f)
+#define DS18B20_TEMP_FLOAT(Temp)		(Temp)
+#endif
 
 /* DS18B20 Resolutions */
 typedef enum {
@@ -52,22 +104,98 @@ typedef enum {
 	DS18B20_Resolution_12bits	= 12
 } DS18B20_Res_t;
 
+/* Scratchpad integrity policy of DS18B20_TryRead */
+typedef enum {
+	DS18B20_Verify_Full,				/* 9 bytes with CRC */
+	DS18B20_Verify_Short,				/* Temperature bytes, full on failure */
+	DS18B20_Verify_Periodic				/* Short, full every VerifyEvery */
+} DS18B20_Verify_t;
+
+/* Device status bits */
+#define DS18B20_STAT_BUSY				0x01	/* Conversion started */
+#define DS18B20_STAT_VALID				0x02	/* Temperature holds a sample */
+#define DS18B20_STAT_FAULT				0x04	/* Last read timed out */
+#define DS18B20_STAT_ALARM				0x08	/* Found by last alarm search */
+#define DS18B20_STAT_SEEN				0x10	/* Found by discovery pass */
+#define DS18B20_STAT_CONFIG				0x20	/* Config holds the scratchpad */
+#define DS18B20_STAT_DIRTY				0x40	/* Scratchpad not in EEPROM */
+
+/* Pool bytes per device: ROM, Stamp, ConvEnd, Temperature, Ring, Status,
+ * VerifyCnt, Config */
+#define DS18B20_DEV_SIZE				(8 + 4 + 4 + sizeof(DS18B20_Temp_t) + 7)
+#define DS18B20_POOL_WORDS(Cnt)			(((Cnt) * DS18B20_DEV_SIZE + 7) / 8)
+#define DS18B20_POOL(Name, Cnt)			uint64_t Name[DS18B20_POOL_WORDS(Cnt)]
+
+/* ROM number bytes of a registered device */
+#define DS18B20_ROM(DS, Idx)			((uint8_t *)&(DS)->Rom[Idx])
+
+/* Devices of the last start, answering read slots until converted */
+#define DS18B20_POLL_NONE				0xFFFEU
+#define DS18B20_POLL_ALL				0xFFFFU
+
+/* Device registry, one dense array per field carved from the pool given to
+ * DS18B20_SetPool. Devices are sorted by ROM key, indexes change when a
+ * device is added or removed */
 typedef struct
 {
-	uint8_t 		DevAddr[DS18B20_MaxCnt][8];
-	uint8_t 		AlmAddr[DS18B20_MaxCnt][8];
-	float 			Temperature[DS18B20_MaxCnt];
+	uint64_t		*Rom;				/* ROM number as key, ascending */
+	uint32_t		*Stamp;				/* Tick of last sample */
+	uint32_t		*ConvEnd;			/* Tick conversion is done */
+	DS18B20_Temp_t	*Temperature;
+	uint16_t		*Ring;				/* Sample ring, DS18B20_RING_NONE */
+	uint8_t			*Status;			/* DS18B20_STAT_xxx */
+	uint8_t			*VerifyCnt;			/* Short reads since full */
+	uint8_t			(*Config)[3];		/* Shadow of TH, TL, configuration */
+	uint16_t		Cnt;				/* Registered devices */
+	uint16_t		Size;				/* Devices the pool holds */
+	uint16_t		Dropped;			/* Found with the pool full */
+	DS18B20_Verify_t Verify;
+	uint8_t			VerifyEvery;		/* Full read every Nth sample */
+	uint32_t		Mismatch;			/* Failed reads under Short/Periodic */
 	DS18B20_Res_t	Resolution;
+	uint8_t			Parasite;			/* Parasite powered device on bus */
+	uint16_t		PollIdx;			/* Device started last, POLL_xxx */
+	uint16_t		PollMark;			/* OneWire Resets after the start */
+	struct __DS18B20_Ring_t *Rings;		/* See ds18b20_ring.h, NULL = none */
+	uint16_t		RingCnt;
+	uint32_t		RingMiss;			/* Samples without a free ring */
 } DS18B20_Drv_t;
 
 /* External Function ---------------------------------------------------------*/
+uint16_t DS18B20_SetPool(DS18B20_Drv_t *DS, void *Pool, uint32_t PoolSize);
+int32_t DS18B20_Find(DS18B20_Drv_t *DS, const uint8_t *ROM);
+int32_t DS18B20_Add(DS18B20_Drv_t *DS, const uint8_t *ROM);
+uint8_t DS18B20_Remove(DS18B20_Drv_t *DS, const uint8_t *ROM);
 uint8_t DS18B20_Init(DS18B20_Drv_t *DS, OneWire_t *OW);
-uint8_t DS18B20_Start(OneWire_t* OW, uint8_t *ROM);
-void DS18B20_StartAll(OneWire_t* OW);
+uint8_t DS18B20_ReadPowerSupply(DS18B20_Drv_t *DS, OneWire_t *OW);
+uint8_t DS18B20_Configure(DS18B20_Drv_t *DS, OneWire_t *OW, uint8_t *ROM);
+uint8_t DS18B20_ReadScratchpad(OneWire_t* OW, uint8_t *ROM, uint8_t *data,
+		uint8_t Len);
+uint8_t DS18B20_Start(DS18B20_Drv_t *DS, OneWire_t* OW, uint8_t *ROM);
+void DS18B20_StartAll(DS18B20_Drv_t *DS, OneWire_t* OW);
+uint32_t DS18B20_ConvTime(DS18B20_Res_t Resolution);
+uint8_t DS18B20_IsReady(DS18B20_Drv_t *DS, uint16_t Idx);
+HAL_StatusTypeDef DS18B20_TryRead(DS18B20_Drv_t *DS, OneWire_t* OW,
+		uint16_t Idx, uint32_t Timeout);
 uint8_t DS18B20_Read(OneWire_t* OW, uint8_t *ROM, float *destination);
-uint8_t DS18B20_SetTempAlarm(OneWire_t* OW, uint8_t *ROM, int8_t Low,
-		int8_t High);
+uint8_t DS18B20_ReadRaw(OneWire_t* OW, uint8_t *ROM, int16_t *Raw);
+void DS18B20_RawToFloat(const int16_t *Raw, float *Destination, uint16_t Cnt);
+void DS18B20_RawToCenti(const int16_t *Raw, int16_t *Destination,
+		uint16_t Cnt);
+uint8_t DS18B20_LoadConfig(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx);
+uint8_t DS18B20_SetConfig(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx,
+		DS18B20_Res_t Resolution, int8_t Low, int8_t High);
+uint8_t DS18B20_SetConfigAll(DS18B20_Drv_t *DS, OneWire_t *OW,
+		DS18B20_Res_t Resolution, int8_t Low, int8_t High, uint8_t Verify);
+uint8_t DS18B20_SetResolution(DS18B20_Drv_t *DS, OneWire_t *OW, uint16_t Idx,
+		DS18B20_Res_t Resolution);
+uint8_t DS18B20_SetTempAlarm(DS18B20_Drv_t *DS, OneWire_t* OW, uint16_t Idx,
+		int8_t Low, int8_t High);
+uint16_t DS18B20_Commit(DS18B20_Drv_t *DS, OneWire_t *OW);
 uint8_t DS18B20_AlarmSearch(DS18B20_Drv_t *DS, OneWire_t* OW);
+void DS18B20_Port_StartAll(OneWire_Port_t *P, uint16_t Mask);
+uint16_t DS18B20_Port_Read(OneWire_Port_t *P, uint16_t Mask,
+		uint8_t ROM[][8], DS18B20_Temp_t *Destination);
 
 #ifdef __cplusplus
 }
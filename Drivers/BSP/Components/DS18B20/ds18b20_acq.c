@@ -0,0 +1,555 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_acq.c
+  * @brief   This file includes the pipelined acquisition engine for DS18B20.
+  * 		 Conversion of one device group overlaps the scratchpad reads of
+  * 		 the others
+  ******************************************************************************
+  */
+#include "ds18b20_acq.h"
+#include <string.h>
+
+/**
+  * @brief  The function is used to initialize the engine
+  * @param  Acq		Acquisition engine HandleTypedef
+  * @param  Period	Target sample period of every device in millisecond,
+  * 				0 = as fast as the bus allows
+  */
+void DS18B20_Acq_Init(DS18B20_Acq_t *Acq, uint32_t Period)
+{
+	Acq->BusCnt = 0;
+	Acq->AlarmSearch = 1;
+	Acq->Discovery = 0;
+	Acq->Period = Period;
+	Acq->StartTick = HAL_GetTick();
+}
+
+/**
+  * @brief  The internal function is used to update a mean time, the last
+  * 		sample weighs 1/8
+  * @param  Mean	Mean time in microsecond, 0 = no sample yet
+  * @param  Cycles	DWT cycles of the last sample
+  */
+static void DS18B20_Acq_Mean(uint32_t *Mean, uint32_t Cycles)
+{
+	uint32_t us = Cycles / DwtCycUs;
+
+	if (*Mean == 0)
+	{
+		*Mean = us;
+	} else {
+		*Mean = *Mean - (*Mean >> 3) + (us >> 3);
+	}
+}
+
+/**
+  * @brief  The internal function is used to choose the number of groups of
+  * 		a bus. A group pays one Match ROM start per device to hide the
+  * 		conversion of the others, when reading takes longer than the
+  * 		conversion a single Skip ROM group is faster. A parasite bus
+  * 		always has a single group
+  * @retval Number of groups
+  * @param  B		Bus of the engine
+  */
+static uint8_t DS18B20_Acq_Groups(DS18B20_AcqBus_t *B)
+{
+	uint16_t cnt = B->DS->Cnt;
+	uint8_t groups = (B->GroupReq > cnt) ? cnt : B->GroupReq;
+	uint32_t conv, one, many;
+
+	/* Every start holds the strong pull-up for a whole conversion, a
+	 * group of N devices would block the bus N conversions long */
+	if (groups > 1 && B->DS->Parasite) return 1;
+
+	/* Start and read not measured yet */
+	if (groups <= 1 || B->StartUs == 0 || B->ReadUs == 0) return groups;
+
+	/* Cycle time (us) of one group: conversion, then every read. Of the
+	 * groups: every start and read, or a conversion and one group */
+	conv = DS18B20_ConvTime(B->DS->Resolution) * 1000U;
+	one = conv + cnt * B->ReadUs;
+	many = cnt * (B->StartUs + B->ReadUs);
+	if (many < conv + (cnt / groups) * (B->StartUs + B->ReadUs))
+	{
+		many = conv + (cnt / groups) * (B->StartUs + B->ReadUs);
+	}
+	return (many < one) ? groups : 1;
+}
+
+/**
+  * @brief  The internal function is used to split the devices of a bus into
+  * 		groups of equal size, all groups start over
+  * @param  B		Bus of the engine
+  */
+static void DS18B20_Acq_Split(DS18B20_AcqBus_t *B)
+{
+	uint16_t first = 0;
+	uint16_t cnt = B->DS->Cnt;
+
+	B->GroupCnt = DS18B20_Acq_Groups(B);
+	B->Cur = 0;
+	B->Rounds = 0;
+	B->Cycle = 0;
+
+	for (uint8_t g = 0; g < B->GroupCnt; g++)
+	{
+		DS18B20_AcqGroup_t *G = &B->Group[g];
+
+		/* Spread the remainder over the first groups */
+		G->First = first;
+		G->Cnt = cnt / B->GroupCnt + ((g < cnt % B->GroupCnt) ? 1 : 0);
+		G->Next = 0;
+		G->State = DS18B20_Acq_Idle;
+		G->Started = 0;
+		first += G->Cnt;
+	}
+}
+
+/**
+  * @brief  The function is used to add an initialized bus, its devices are
+  * 		split into groups of equal size. A bus without devices has no
+  * 		group until discovery finds some
+  * @retval status in OK = 1, Failed = 0
+  * @param  Acq			Acquisition engine HandleTypedef
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  GroupCnt	Number of groups, limited to DS18B20_ACQ_MAXGROUP and
+  * 					the number of devices
+  */
+uint8_t DS18B20_Acq_AddBus(DS18B20_Acq_t *Acq, DS18B20_Drv_t *DS,
+		OneWire_t *OW, uint8_t GroupCnt)
+{
+	DS18B20_AcqBus_t *B;
+
+	if (Acq->BusCnt >= DS18B20_ACQ_MAXBUS) return 0;
+	if (GroupCnt > DS18B20_ACQ_MAXGROUP) GroupCnt = DS18B20_ACQ_MAXGROUP;
+	if (GroupCnt == 0) return 0;
+
+	B = &Acq->Bus[Acq->BusCnt];
+	B->DS = DS;
+	B->OW = OW;
+	B->GroupReq = GroupCnt;
+	B->DiscRun = 0;
+	B->DiscStarted = 0;
+	B->DiscReads = 0;
+	B->Snap = NULL;
+	B->StartUs = 0;
+	B->ReadUs = 0;
+	B->BusyCycles = 0;
+	B->Samples = 0;
+	B->Errors = 0;
+	B->Timeouts = 0;
+	DS18B20_Acq_Split(B);
+
+	Acq->BusCnt++;
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to start the conversion of the
+  * 		next device of a group
+  * @param  B		Bus of the engine
+  * @param  G		Group being started
+  */
+static void DS18B20_Acq_StartNext(DS18B20_AcqBus_t *B, DS18B20_AcqGroup_t *G)
+{
+	uint32_t t = DWT_CYCCNT;
+
+	DS18B20_Start(B->DS, B->OW, DS18B20_ROM(B->DS, G->First + G->Next));
+	DS18B20_Acq_Mean(&B->StartUs, DWT_CYCCNT - t);
+
+	if (++G->Next >= G->Cnt)
+	{
+		G->State = DS18B20_Acq_Conv;
+		G->Next = 0;
+	}
+}
+
+/**
+  * @brief  The internal function is used to start the conversion of a group,
+  * 		the whole bus at once, else its first device
+  * @param  B		Bus of the engine
+  * @param  G		Group to start
+  * @param  Now		Current tick
+  */
+static void DS18B20_Acq_StartGroup(DS18B20_AcqBus_t *B, DS18B20_AcqGroup_t *G,
+		uint32_t Now)
+{
+	G->Next = 0;
+	G->Started = 1;
+	G->StartAt = Now;
+
+	if (G->Cnt == B->DS->Cnt)
+	{
+		/* Whole bus, skip rom */
+		DS18B20_StartAll(B->DS, B->OW);
+		G->State = DS18B20_Acq_Conv;
+		return;
+	}
+
+	/* One Match ROM start per call */
+	G->State = DS18B20_Acq_Start;
+	DS18B20_Acq_StartNext(B, G);
+}
+
+/**
+  * @brief  The internal function is used to read the next device of a group
+  * @retval Bus used = 1, Not yet ready = 0
+  * @param  B		Bus of the engine
+  * @param  G		Group being read
+  */
+static uint8_t DS18B20_Acq_ReadNext(DS18B20_AcqBus_t *B, DS18B20_AcqGroup_t *G)
+{
+	uint32_t t = DWT_CYCCNT;
+
+	switch (DS18B20_TryRead(B->DS, B->OW, G->First + G->Next,
+			DS18B20_ACQ_TIMEOUT))
+	{
+		case HAL_BUSY:
+			/* Not converted yet, or failed read to retry */
+			return DS18B20_IsReady(B->DS, G->First + G->Next) ? 1 : 0;
+		case HAL_OK:
+			DS18B20_Acq_Mean(&B->ReadUs, DWT_CYCCNT - t);
+			B->Samples++;
+			break;
+		case HAL_TIMEOUT:
+			B->Timeouts++;
+			break;
+		default:
+			B->Errors++;
+			break;
+	}
+
+	if (B->DiscReads < 0xFF) B->DiscReads++;
+	G->State = DS18B20_Acq_Read;
+	if (++G->Next >= G->Cnt)
+	{
+		G->State = DS18B20_Acq_Idle;
+		B->Rounds++;
+
+		/* Every group read once, the cycle is complete */
+		if (++B->Cycle >= B->GroupCnt)
+		{
+			B->Cycle = 0;
+			if (B->Snap != NULL) DS18B20_Snap_Publish(B->Snap, B->DS);
+
+			/* Starts and reads measured, regroup if one group is faster */
+			if (DS18B20_Acq_Groups(B) != B->GroupCnt) DS18B20_Acq_Split(B);
+		}
+	}
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to swap the search state of the
+  * 		discovery pass with the one of the bus, the alarm search in
+  * 		between keeps its own
+  * @param  B		Bus of the engine
+  */
+static void DS18B20_Acq_SwapSearch(DS18B20_AcqBus_t *B)
+{
+	OneWire_t *OW = B->OW;
+	uint8_t t;
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		t = OW->RomByte[i];
+		OW->RomByte[i] = B->DiscRom[i];
+		B->DiscRom[i] = t;
+	}
+	t = OW->LastDiscrepancy;
+	OW->LastDiscrepancy = B->DiscLast;
+	B->DiscLast = t;
+	t = OW->LastFamilyDiscrepancy;
+	OW->LastFamilyDiscrepancy = B->DiscLastFamily;
+	B->DiscLastFamily = t;
+	t = OW->LastDeviceFlag;
+	OW->LastDeviceFlag = B->DiscLastDevice;
+	B->DiscLastDevice = t;
+}
+
+/**
+  * @brief  The internal function is used to end a complete discovery pass,
+  * 		devices not found are removed
+  * @retval Registry changed = 1, Unchanged = 0
+  * @param  B		Bus of the engine
+  */
+static uint8_t DS18B20_Acq_DiscoverEnd(DS18B20_AcqBus_t *B)
+{
+	DS18B20_Drv_t *DS = B->DS;
+	uint8_t rom[8];
+	uint8_t changed = 0;
+
+	B->DiscRun = 0;
+	for (uint16_t i = DS->Cnt; i > 0; i--)
+	{
+		if (DS->Status[i - 1] & DS18B20_STAT_SEEN) continue;
+
+		memcpy(rom, DS18B20_ROM(DS, i - 1), 8);
+		DS18B20_Remove(DS, rom);
+		DS18B20_Acq_RemovedCallback(DS, B->OW, rom);
+		changed = 1;
+	}
+	return changed;
+}
+
+/**
+  * @brief  The internal function is used to search the next device of the
+  * 		discovery pass, a new pass starts every Acq->Discovery ms
+  * @retval Bus used = 1, Nothing to do = 0
+  * @param  Acq		Acquisition engine HandleTypedef
+  * @param  B		Bus of the engine
+  * @param  Now		Current tick
+  */
+static uint8_t DS18B20_Acq_Discover(DS18B20_Acq_t *Acq, DS18B20_AcqBus_t *B,
+		uint32_t Now)
+{
+	DS18B20_Drv_t *DS = B->DS;
+	uint8_t rom[8];
+	uint8_t found, last = 0, changed = 0;
+	int32_t idx;
+
+	if (!B->DiscRun)
+	{
+		if (!Acq->Discovery) return 0;
+		if (B->DiscStarted && (Now - B->DiscAt) < Acq->Discovery) return 0;
+
+		/* New pass over family 0x28 */
+		B->DiscRun = 1;
+		B->DiscStarted = 1;
+		B->DiscAt = Now;
+		B->DiscCnt = 0;
+		for (uint16_t i = 0; i < DS->Cnt; i++)
+		{
+			DS->Status[i] &= ~DS18B20_STAT_SEEN;
+		}
+		OneWire_OS_Lock(B->OW);
+		DS18B20_Acq_SwapSearch(B);
+		OneWire_TargetSetup(B->OW, DS18B20_FAMILY_CODE);
+		DS18B20_Acq_SwapSearch(B);
+		OneWire_OS_Unlock(B->OW);
+	}
+
+	/* Search state of the handle is borrowed */
+	B->DiscReads = 0;
+	OneWire_OS_Lock(B->OW);
+	DS18B20_Acq_SwapSearch(B);
+	found = OneWire_Search(B->OW, ONEWIRE_CMD_SEARCHROM);
+	if (found)
+	{
+		OneWire_GetDevRom(B->OW, rom);
+		last = B->OW->LastDeviceFlag;
+	} else if (B->DiscCnt == 0 && OneWire_Reset(B->OW)) {
+		/* No presence pulse, every device is gone */
+		last = 1;
+	} else {
+		/* Search disturbed, no device is removed on this pass */
+		B->DiscRun = 0;
+	}
+	DS18B20_Acq_SwapSearch(B);
+	OneWire_OS_Unlock(B->OW);
+
+	if (found && rom[0] != DS18B20_FAMILY_CODE)
+	{
+		/* Past the last DS18B20 */
+		found = 0;
+		last = 1;
+	}
+
+	if (found)
+	{
+		B->DiscCnt++;
+		idx = DS18B20_Find(DS, rom);
+		if (idx < 0)
+		{
+			idx = DS18B20_Add(DS, rom);
+			if (idx >= 0)
+			{
+				DS18B20_Configure(DS, B->OW, rom);
+				DS18B20_Acq_AddedCallback(DS, B->OW, rom);
+				changed = 1;
+			}
+		}
+		if (idx >= 0) DS->Status[idx] |= DS18B20_STAT_SEEN;
+	}
+
+	if (last && DS18B20_Acq_DiscoverEnd(B)) changed = 1;
+	if (last) B->DiscRun = 0;
+
+	/* Groups are index ranges of the registry */
+	if (changed) DS18B20_Acq_Split(B);
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to do the next operation of a bus.
+  * 		The alarm search once all groups are read comes first, so a
+  * 		saturated bus still gets to it, then a discovery step every
+  * 		DS18B20_ACQ_DISC_READS reads, then starting a group that is due
+  * 		as it keeps the devices busy, then reading a converted group,
+  * 		then one discovery step when the bus is idle
+  * @retval Bus used = 1, Nothing to do = 0
+  * @param  Acq		Acquisition engine HandleTypedef
+  * @param  B		Bus of the engine
+  */
+static uint8_t DS18B20_Acq_Step(DS18B20_Acq_t *Acq, DS18B20_AcqBus_t *B)
+{
+	uint32_t now = HAL_GetTick();
+	uint8_t g, idx;
+
+	/* Every group read since the last search */
+	if (Acq->AlarmSearch && B->GroupCnt && B->Rounds >= B->GroupCnt)
+	{
+		DS18B20_AlarmSearch(B->DS, B->OW);
+		B->Rounds = 0;
+		return 1;
+	}
+
+	/* Discovery goes on whatever the load */
+	if (B->DiscReads >= DS18B20_ACQ_DISC_READS &&
+			DS18B20_Acq_Discover(Acq, B, now))
+	{
+		return 1;
+	}
+
+	/* Go on with a group being started */
+	for (g = 0; g < B->GroupCnt; g++)
+	{
+		if (B->Group[g].State == DS18B20_Acq_Start)
+		{
+			DS18B20_Acq_StartNext(B, &B->Group[g]);
+			return 1;
+		}
+	}
+
+	/* Start the next group that is due, round robin */
+	for (g = 0; g < B->GroupCnt; g++)
+	{
+		DS18B20_AcqGroup_t *G;
+
+		idx = (B->Cur + g) % B->GroupCnt;
+		G = &B->Group[idx];
+		if (G->State != DS18B20_Acq_Idle) continue;
+		if (G->Started && (now - G->StartAt) < Acq->Period) continue;
+
+		DS18B20_Acq_StartGroup(B, G, now);
+		B->Cur = (idx + 1) % B->GroupCnt;
+		return 1;
+	}
+
+	/* Read a group with finished conversion */
+	for (g = 0; g < B->GroupCnt; g++)
+	{
+		idx = (B->Cur + g) % B->GroupCnt;
+		if ((B->Group[idx].State == DS18B20_Acq_Conv ||
+				B->Group[idx].State == DS18B20_Acq_Read) &&
+				DS18B20_Acq_ReadNext(B, &B->Group[idx]))
+		{
+			return 1;
+		}
+	}
+
+	/* Bus idle, look for plugged or unplugged devices */
+	return DS18B20_Acq_Discover(Acq, B, now);
+}
+
+/**
+  * @brief  The function is used to run the engine, call it from main loop
+  * @retval Bus used = 1, Nothing to do = 0
+  * @param  Acq		Acquisition engine HandleTypedef
+  */
+uint8_t DS18B20_Acq_Process(DS18B20_Acq_t *Acq)
+{
+	uint8_t busy = 0;
+	uint32_t t;
+
+	for (uint8_t b = 0; b < Acq->BusCnt; b++)
+	{
+		t = DWT_CYCCNT;
+		if (DS18B20_Acq_Step(Acq, &Acq->Bus[b]))
+		{
+			Acq->Bus[b].BusyCycles += DWT_CYCCNT - t;
+			busy = 1;
+		}
+	}
+	return busy;
+}
+
+/**
+  * @brief  The function is used to publish a snapshot of a bus at the end
+  * 		of each cycle
+  * @retval status in OK = 1, Bus not added = 0
+  * @param  Acq		Acquisition engine HandleTypedef
+  * @param  DS		DS18B20 HandleTypedef of the bus
+  * @param  Snap	Initialized snapshot, NULL = stop publishing
+  */
+uint8_t DS18B20_Acq_SetSnapshot(DS18B20_Acq_t *Acq, DS18B20_Drv_t *DS,
+		DS18B20_Snap_t *Snap)
+{
+	for (uint8_t b = 0; b < Acq->BusCnt; b++)
+	{
+		if (Acq->Bus[b].DS != DS) continue;
+
+		Acq->Bus[b].Snap = Snap;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  The function is used to get throughput and bus utilisation since
+  * 		DS18B20_Acq_Init
+  * @param  Acq		Acquisition engine HandleTypedef
+  * @param  Stats	Pointer to return value
+  */
+void DS18B20_Acq_GetStats(DS18B20_Acq_t *Acq, DS18B20_AcqStats_t *Stats)
+{
+	uint32_t ms = HAL_GetTick() - Acq->StartTick;
+	float cycles = (float)ms * (float)(SystemCoreClock / 1000U);
+
+	Stats->Samples = 0;
+	Stats->Errors = 0;
+	Stats->Timeouts = 0;
+	for (uint8_t b = 0; b < DS18B20_ACQ_MAXBUS; b++)
+	{
+		Stats->Util[b] = 0;
+		if (b >= Acq->BusCnt) continue;
+
+		Stats->Samples += Acq->Bus[b].Samples;
+		Stats->Errors += Acq->Bus[b].Errors;
+		Stats->Timeouts += Acq->Bus[b].Timeouts;
+		if (ms) Stats->Util[b] = (float)Acq->Bus[b].BusyCycles / cycles;
+	}
+	Stats->Rate = ms ? (float)Stats->Samples * 1000.0f / (float)ms : 0;
+}
+
+/**
+  * @brief  Device found by discovery, added to the registry and configured
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		ROM number of the device
+  */
+__weak void DS18B20_Acq_AddedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)DS;
+	(void)OW;
+	(void)ROM;
+}
+
+/**
+  * @brief  Device missing from a complete discovery pass, already removed
+  * 		from the registry
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		ROM number of the device
+  */
+__weak void DS18B20_Acq_RemovedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)DS;
+	(void)OW;
+	(void)ROM;
+}
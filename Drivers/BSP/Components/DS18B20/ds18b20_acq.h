@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_acq.h
+  * @brief   This file contains all the constants parameters for the DS18B20
+  * 		 pipelined acquisition engine
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Initialize every bus with DS18B20_Init, then add it to the engine
+  *		with the number of device groups. Groups on a bus are started one
+  *		after the other, so a group is read while the next is converting.
+  *		Call DS18B20_Acq_Process from the main loop, each call does at most
+  *		one bus operation per bus and returns 0 when there is nothing to do
+  *		yet, the caller may then sleep.
+  *
+  *		A group is started one device per call with Match ROM, a single
+  *		group with Skip ROM. Once the start and read times are measured,
+  *		at the end of every cycle, a bus where reading all devices costs
+  *		more than the conversion the groups hide falls back to one group.
+  *		A parasite powered bus (DS->Parasite) always uses one group: every
+  *		start holds the strong pull-up for a whole conversion, one Skip
+  *		ROM start converts all devices in that time.
+  *
+  *		DS18B20_Acq_Init(&Acq, 1000);
+  *		DS18B20_Acq_AddBus(&Acq, &DS, &OW, 2);
+  *		while (1)
+  *		{
+  *			if (!DS18B20_Acq_Process(&Acq)) HAL_Delay(1);
+  *		}
+  *
+  *		Set Acq.Discovery to run a background search pass on every bus at
+  *		that period (ms). One device is searched per call when the bus has
+  *		nothing else to do, and every DS18B20_ACQ_DISC_READS reads on a
+  *		busy bus, sampling goes on meanwhile. Devices found are
+  *		added to the registry and configured, devices missing from a
+  *		complete pass are removed, DS18B20_Acq_AddedCallback and
+  *		DS18B20_Acq_RemovedCallback report both. Groups are split again
+  *		after a change.
+  *
+  *		DS18B20_Acq_SetSnapshot gives a bus a snapshot, published once
+  *		every group of the bus was read, see ds18b20_snap.h.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DS18B20_ACQ_H
+#define DS18B20_ACQ_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds18b20.h"
+#include "ds18b20_snap.h"
+
+/* Data Structure ------------------------------------------------------------*/
+#ifndef DS18B20_ACQ_MAXBUS
+#define DS18B20_ACQ_MAXBUS		4
+#endif
+#ifndef DS18B20_ACQ_MAXGROUP
+#define DS18B20_ACQ_MAXGROUP	8
+#endif
+
+/* Reads between two discovery steps on a busy bus */
+#ifndef DS18B20_ACQ_DISC_READS
+#define DS18B20_ACQ_DISC_READS	4
+#endif
+
+/* Time (ms) a device may convert after its deadline */
+#define DS18B20_ACQ_TIMEOUT		100
+
+typedef enum
+{
+	DS18B20_Acq_Idle,					/* Waiting for next sample time */
+	DS18B20_Acq_Start,					/* Starting devices one by one */
+	DS18B20_Acq_Conv,					/* Converting */
+	DS18B20_Acq_Read					/* Reading devices one by one */
+} DS18B20_AcqState_t;
+
+typedef struct
+{
+	uint16_t		First;				/* First device index in registry */
+	uint16_t		Cnt;				/* Number of devices */
+	uint16_t		Next;				/* Next device to read */
+	uint8_t			State;
+	uint8_t			Started;			/* StartAt is valid */
+	uint32_t		StartAt;			/* Tick of last conversion start */
+} DS18B20_AcqGroup_t;
+
+typedef struct
+{
+	DS18B20_Drv_t	*DS;
+	OneWire_t		*OW;
+	DS18B20_AcqGroup_t Group[DS18B20_ACQ_MAXGROUP];
+	uint8_t			GroupCnt;
+	uint8_t			GroupReq;			/* Group count asked in AddBus */
+	uint8_t			Cur;				/* Group checked first */
+	uint8_t			Rounds;				/* Groups read since alarm search */
+	uint8_t			Cycle;				/* Groups read since publish */
+	uint8_t			DiscRun;			/* Discovery pass running */
+	uint8_t			DiscStarted;		/* DiscAt is valid */
+	uint8_t			DiscReads;			/* Reads since last discovery step */
+	uint8_t			DiscRom[8];			/* Search state of discovery */
+	uint8_t			DiscLast;
+	uint8_t			DiscLastFamily;
+	uint8_t			DiscLastDevice;
+	uint16_t		DiscCnt;			/* Devices found in this pass */
+	uint32_t		DiscAt;				/* Tick of last pass start */
+	DS18B20_Snap_t	*Snap;				/* Published every cycle, NULL = none */
+	uint32_t		StartUs;			/* Mean Match ROM start time (us) */
+	uint32_t		ReadUs;				/* Mean scratchpad read time (us) */
+	uint64_t		BusyCycles;			/* Time spent on the bus */
+	uint32_t		Samples;
+	uint32_t		Errors;
+	uint32_t		Timeouts;
+} DS18B20_AcqBus_t;
+
+typedef struct
+{
+	DS18B20_AcqBus_t Bus[DS18B20_ACQ_MAXBUS];
+	uint8_t			BusCnt;
+	uint8_t			AlarmSearch;		/* Search alarms once per round */
+	uint32_t		Discovery;			/* Hot-plug pass period (ms), 0 = off */
+	uint32_t		Period;				/* Target sample period (ms) */
+	uint32_t		StartTick;
+} DS18B20_Acq_t;
+
+typedef struct
+{
+	float			Rate;				/* Samples per second, all buses */
+	float			Util[DS18B20_ACQ_MAXBUS];	/* Bus busy time, 0 - 1 */
+	uint32_t		Samples;
+	uint32_t		Errors;
+	uint32_t		Timeouts;
+} DS18B20_AcqStats_t;
+
+/* External Function ---------------------------------------------------------*/
+void DS18B20_Acq_Init(DS18B20_Acq_t *Acq, uint32_t Period);
+uint8_t DS18B20_Acq_AddBus(DS18B20_Acq_t *Acq, DS18B20_Drv_t *DS,
+		OneWire_t *OW, uint8_t GroupCnt);
+uint8_t DS18B20_Acq_Process(DS18B20_Acq_t *Acq);
+uint8_t DS18B20_Acq_SetSnapshot(DS18B20_Acq_t *Acq, DS18B20_Drv_t *DS,
+		DS18B20_Snap_t *Snap);
+void DS18B20_Acq_GetStats(DS18B20_Acq_t *Acq, DS18B20_AcqStats_t *Stats);
+void DS18B20_Acq_AddedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM);
+void DS18B20_Acq_RemovedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS18B20_ACQ_H */
@@ -0,0 +1,245 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_cache.c
+  * @brief   This file includes the persistent ROM cache for DS18B20. A boot
+  * 		 checks the cached devices instead of enumerating the bus
+  ******************************************************************************
+  */
+#include "ds18b20_cache.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Image part covered by the CRC */
+#define DS18B20_CACHE_CRC_START		offsetof(DS18B20_CacheHdr_t, Cnt)
+
+/**
+  * @brief  The internal function is used to compute the CRC-32 of the image,
+  * 		bitwise as it only runs at boot and store
+  * @retval CRC-32
+  * @param  Data	Bytes to check
+  * @param  Len		Number of bytes
+  */
+static uint32_t DS18B20_Cache_Crc(const uint8_t *Data, uint32_t Len)
+{
+	uint32_t crc = 0xFFFFFFFFU;
+
+	while (Len--)
+	{
+		crc ^= *Data++;
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 0x01)));
+		}
+	}
+	return ~crc;
+}
+
+/**
+  * @brief  The internal function is used to get the sort key of a ROM, the
+  * 		same order as the registry
+  * @retval ROM key
+  * @param  ROM		Pointer to ROM number
+  */
+static uint64_t DS18B20_Cache_Key(const uint8_t *ROM)
+{
+	uint64_t key;
+
+	memcpy(&key, ROM, 8);
+	return key;
+}
+
+/**
+  * @brief  The function is used to check an image, magic, size and CRC
+  * @retval Valid = 1, Invalid = 0
+  * @param  Image		Cache image, 4 byte aligned
+  * @param  Size		Size of the image storage in byte
+  */
+uint8_t DS18B20_Cache_IsValid(const void *Image, uint32_t Size)
+{
+	const DS18B20_CacheHdr_t *H = Image;
+	uint32_t len;
+
+	if (Size < sizeof(DS18B20_CacheHdr_t)) return 0;
+	if (H->Magic != DS18B20_CACHE_MAGIC) return 0;
+
+	len = DS18B20_CACHE_SIZE(H->Cnt);
+	if (len > Size) return 0;
+
+	return (DS18B20_Cache_Crc((const uint8_t *)Image + DS18B20_CACHE_CRC_START,
+			len - DS18B20_CACHE_CRC_START) == H->Crc) ? 1 : 0;
+}
+
+/**
+  * @brief  The function is used to write the registered devices and their
+  * 		configuration to an image, from the shadow or read back from
+  * 		the device. Call DS18B20_Commit first, the image holds what
+  * 		the devices load at power up
+  * @retval Image length in byte, Failed = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Image		Cache image, 4 byte aligned
+  * @param  Size		Size of the image storage in byte
+  */
+uint32_t DS18B20_Cache_Store(DS18B20_Drv_t *DS, OneWire_t *OW, void *Image,
+		uint32_t Size)
+{
+	DS18B20_CacheHdr_t *H = Image;
+	DS18B20_CacheEntry_t *E = (DS18B20_CacheEntry_t *)(H + 1);
+	uint32_t len = DS18B20_CACHE_SIZE(DS->Cnt);
+
+	if (len > Size) return 0;
+
+	/* Invalid until complete, a reset while storing drops the image */
+	H->Magic = 0;
+
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		/* Shadow holds the configuration, the bus is read without one */
+		if (!(DS->Status[i] & DS18B20_STAT_CONFIG) &&
+				!DS18B20_LoadConfig(DS, OW, i))
+		{
+			return 0;
+		}
+		memcpy(E[i].Rom, DS18B20_ROM(DS, i), 8);
+		memcpy(E[i].Config, DS->Config[i], 3);
+	}
+
+	H->Cnt = DS->Cnt;
+	H->Resolution = DS->Resolution;
+	H->Reserved = 0;
+	H->Crc = DS18B20_Cache_Crc((const uint8_t *)Image +
+			DS18B20_CACHE_CRC_START, len - DS18B20_CACHE_CRC_START);
+	H->Magic = DS18B20_CACHE_MAGIC;
+	return len;
+}
+
+/**
+  * @brief  The internal function is used to check every cached device with
+  * 		one scratchpad read, no search
+  * @retval All devices answer with cached configuration = 1, Mismatch = 0
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  H		Valid cache image
+  */
+static uint8_t DS18B20_Cache_VerifyAll(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const DS18B20_CacheHdr_t *H)
+{
+	const DS18B20_CacheEntry_t *E = (const DS18B20_CacheEntry_t *)(H + 1);
+	uint8_t rom[8], data[9];
+	int32_t idx;
+
+	for (uint16_t i = 0; i < H->Cnt; i++)
+	{
+		memcpy(rom, E[i].Rom, 8);
+		if (!DS18B20_ReadScratchpad(OW, rom, data, 9)) return 0;
+		if (memcmp(&data[2], E[i].Config, 3) != 0) return 0;
+		idx = DS18B20_Add(DS, rom);
+		if (idx < 0) return 0;
+
+		/* Shadow from the read just done */
+		memcpy(DS->Config[idx], &data[2], 3);
+		DS->Status[idx] |= DS18B20_STAT_CONFIG;
+	}
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to run one search pass over the
+  * 		DS18B20 family and compare it to the cache, only devices missing
+  * 		in the cache are configured
+  * @retval Bus equals cache = 1, Mismatch = 0
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  H		Valid cache image, NULL = none
+  */
+static uint8_t DS18B20_Cache_SearchAll(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const DS18B20_CacheHdr_t *H)
+{
+	const DS18B20_CacheEntry_t *E = H ? (const DS18B20_CacheEntry_t *)(H + 1) :
+			NULL;
+	uint16_t cnt = H ? H->Cnt : 0;
+	uint16_t j = 0;
+	uint8_t rom[8];
+	uint8_t match = H ? 1 : 0;
+	uint64_t key;
+
+	/* Search DS18B20 ROM only, other families on the line are skipped */
+	OneWire_TargetSetup(OW, DS18B20_FAMILY_CODE);
+	while (OneWire_Search(OW, ONEWIRE_CMD_SEARCHROM))
+	{
+		if (OW->RomByte[0] != DS18B20_FAMILY_CODE)
+		{
+			OneWire_ResetSearch(OW);
+			break;
+		}
+		OneWire_GetDevRom(OW, rom);
+		if (DS18B20_Add(DS, rom) < 0) match = 0;
+	}
+
+	/* Registry and cache are both sorted by key, walk them together */
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		key = DS18B20_Cache_Key(DS18B20_ROM(DS, i));
+		while (j < cnt && DS18B20_Cache_Key(E[j].Rom) < key)
+		{
+			/* Cached device gone */
+			j++;
+			match = 0;
+		}
+		if (j < cnt && DS18B20_Cache_Key(E[j].Rom) == key)
+		{
+			/* Shadow from the cache, as stored from the bus */
+			memcpy(DS->Config[i], E[j].Config, 3);
+			DS->Status[i] |= DS18B20_STAT_CONFIG;
+			j++;
+			continue;
+		}
+
+		/* New device */
+		DS18B20_Configure(DS, OW, DS18B20_ROM(DS, i));
+		match = 0;
+	}
+	return (match && j == cnt) ? 1 : 0;
+}
+
+/**
+  * @brief  The function is used to initialize the registry from a cache
+  * 		image, with a cheap check of the bus instead of a full
+  * 		DS18B20_Init. Verify falls back to DS18B20_Init on mismatch,
+  * 		Search configures the devices missing in the cache
+  * @retval Bus matches cache = 1, Image should be stored again = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  OW			OneWire HandleTypedef
+  * @param  Image		Cache image, 4 byte aligned
+  * @param  Size		Size of the image storage in byte
+  * @param  Check		DS18B20_Cache_Verify or DS18B20_Cache_Search
+  */
+uint8_t DS18B20_Cache_Boot(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const void *Image, uint32_t Size, DS18B20_CacheCheck_t Check)
+{
+	const DS18B20_CacheHdr_t *H = Image;
+	uint8_t valid, hit;
+
+	/* Image made for this bus setup */
+	valid = DS18B20_Cache_IsValid(Image, Size) &&
+			H->Resolution == DS->Resolution && H->Cnt <= DS->Size;
+
+	/* Initialize OneWire and reset all data */
+	OneWire_Init(OW);
+	OneWire_OS_Lock(OW);
+	DS->Cnt = 0;
+	DS->Dropped = 0;
+	DS18B20_ReadPowerSupply(DS, OW);
+
+	if (Check == DS18B20_Cache_Search)
+	{
+		hit = DS18B20_Cache_SearchAll(DS, OW, valid ? H : NULL);
+	} else {
+		hit = valid && DS18B20_Cache_VerifyAll(DS, OW, H);
+
+		/* No image or bus changed, full enumeration */
+		if (!hit) DS18B20_Init(DS, OW);
+	}
+	OneWire_OS_Unlock(OW);
+	return hit;
+}
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_cache.h
+  * @brief   This file contains all the constants parameters for the DS18B20
+  * 		 persistent ROM cache
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		The cache image holds the registered ROM numbers with the TH, TL and
+  *		configuration bytes of each device, protected by a CRC-32. Keep it
+  *		in backup SRAM, or in RAM copied to and from flash by the
+  *		application. At boot DS18B20_Cache_Boot checks the bus against the
+  *		image and fills the registry from it, a full DS18B20_Init only runs
+  *		on mismatch. Store the image again when it returns 0:
+  *
+  *		DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+  *		if (!DS18B20_Cache_Boot(&DS, &OW, Image, sizeof(Image),
+  *				DS18B20_Cache_Verify))
+  *		{
+  *			DS18B20_Cache_Store(&DS, &OW, Image, sizeof(Image));
+  *		}
+  *
+  *		Store again after DS18B20_Commit of a new alarm or resolution, the
+  *		configuration is part of the check of DS18B20_Cache_Verify.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DS18B20_CACHE_H
+#define DS18B20_CACHE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds18b20.h"
+
+/* Data Structure ------------------------------------------------------------*/
+#define DS18B20_CACHE_MAGIC		0x31435344U		/* "DSC1" */
+
+/* Image size (byte) for Cnt devices */
+#define DS18B20_CACHE_SIZE(Cnt)	(sizeof(DS18B20_CacheHdr_t) + \
+		(Cnt) * sizeof(DS18B20_CacheEntry_t))
+
+/* Boot check against the bus */
+typedef enum
+{
+	DS18B20_Cache_Verify,				/* Read scratchpad of cached ROMs,
+										 * added devices are not seen */
+	DS18B20_Cache_Search				/* One search pass compared to cache */
+} DS18B20_CacheCheck_t;
+
+typedef struct
+{
+	uint32_t		Magic;
+	uint32_t		Crc;				/* CRC-32 from Cnt to image end */
+	uint16_t		Cnt;
+	uint8_t			Resolution;
+	uint8_t			Reserved;
+} DS18B20_CacheHdr_t;
+
+typedef struct
+{
+	uint8_t			Rom[8];
+	uint8_t			Config[3];			/* Scratchpad TH, TL, configuration */
+} DS18B20_CacheEntry_t;
+
+/* External Function ---------------------------------------------------------*/
+uint8_t DS18B20_Cache_IsValid(const void *Image, uint32_t Size);
+uint32_t DS18B20_Cache_Store(DS18B20_Drv_t *DS, OneWire_t *OW, void *Image,
+		uint32_t Size);
+uint8_t DS18B20_Cache_Boot(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const void *Image, uint32_t Size, DS18B20_CacheCheck_t Check);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS18B20_CACHE_H */
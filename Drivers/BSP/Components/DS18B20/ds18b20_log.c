@@ -0,0 +1,490 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_log.c
+  * @brief   This file includes the delta encoded flash log for DS18B20,
+  * 		 append only over a ring of erase blocks
+  ******************************************************************************
+  */
+#include "ds18b20_log.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Header and footer take whole program units */
+#define DS18B20_LOG_AREA(Len, Unit)	\
+		(((Len) + (Unit) - 1) & ~((uint32_t)(Unit) - 1))
+
+/* Erased footer length, block still open */
+#define DS18B20_LOG_OPEN			0xFFFFFFFFU
+
+/* CRC-32 nibble table, polynomial 0xEDB88320 */
+static const uint32_t DS18B20_Log_CrcTab[16] =
+{
+	0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+	0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+	0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+	0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+};
+
+/**
+  * @brief  The function is used to compute or continue a CRC-32
+  * @retval CRC-32
+  * @param  Crc		CRC of the bytes before, 0 = start
+  * @param  Data	Bytes to check
+  * @param  Len		Number of bytes
+  */
+uint32_t DS18B20_Log_Crc(uint32_t Crc, const uint8_t *Data, uint32_t Len)
+{
+	uint32_t crc = ~Crc;
+
+	while (Len--)
+	{
+		crc ^= *Data++;
+		crc = (crc >> 4) ^ DS18B20_Log_CrcTab[crc & 0x0F];
+		crc = (crc >> 4) ^ DS18B20_Log_CrcTab[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+/**
+  * @brief  The internal function is used to check a block header
+  * @retval Valid = 1, Invalid = 0
+  * @param  H		Block header
+  */
+static uint8_t DS18B20_Log_HdrValid(const DS18B20_LogHdr_t *H)
+{
+	if (H->Magic != DS18B20_LOG_MAGIC) return 0;
+	if (H->Unit == 0 || H->Unit > DS18B20_LOG_UNIT_MAX ||
+			(H->Unit & (H->Unit - 1)) != 0)
+	{
+		return 0;
+	}
+	return (DS18B20_Log_Crc(0, (const uint8_t *)H,
+			offsetof(DS18B20_LogHdr_t, Crc)) == H->Crc) ? 1 : 0;
+}
+
+/**
+  * @brief  The internal function is used to append a zigzag varint
+  * @retval Number of bytes
+  * @param  Out		Destination, 5 bytes
+  * @param  Value	Signed value
+  */
+static uint8_t DS18B20_Log_PutVar(uint8_t *Out, int32_t Value)
+{
+	uint32_t v = ((uint32_t)Value << 1) ^ (uint32_t)(Value >> 31);
+	uint8_t n = 0;
+
+	while (v >= 0x80)
+	{
+		Out[n++] = (uint8_t)v | 0x80;
+		v >>= 7;
+	}
+	Out[n++] = (uint8_t)v;
+	return n;
+}
+
+/**
+  * @brief  The internal function is used to read a zigzag varint
+  * @retval OK = 1, Truncated or too long = 0
+  * @param  Data	Block
+  * @param  Pos		Read position, moved past the varint
+  * @param  End		Data end
+  * @param  Value	Pointer to return value
+  */
+static uint8_t DS18B20_Log_GetVar(const uint8_t *Data, uint32_t *Pos,
+		uint32_t End, int32_t *Value)
+{
+	uint32_t v = 0;
+	uint8_t b, shift = 0;
+
+	do
+	{
+		if (*Pos >= End || shift > 28) return 0;
+		b = Data[(*Pos)++];
+		v |= (uint32_t)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+
+	*Value = (int32_t)(v >> 1) ^ -(int32_t)(v & 0x01);
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to program the chunk, padded with
+  * 		erased bytes to a whole unit
+  * @retval status in OK = 1, Failed = 0
+  * @param  Log		Log HandleTypedef
+  */
+static uint8_t DS18B20_Log_Program(DS18B20_Log_t *Log)
+{
+	uint8_t ok;
+
+	memset(&Log->Chunk[Log->Fill], DS18B20_LOG_ERASED, Log->Unit - Log->Fill);
+	ok = Log->Ops->Program(Log, Log->Cur * Log->BlockSize + Log->Pos,
+			Log->Chunk, Log->Unit);
+	Log->Crc = DS18B20_Log_Crc(Log->Crc, Log->Chunk, Log->Unit);
+	Log->Pos += Log->Unit;
+	Log->Fill = 0;
+	if (!ok)
+	{
+		/* Block content unknown, the next record opens a new one */
+		Log->Failed++;
+		Log->Open = 0;
+	}
+	return ok;
+}
+
+/**
+  * @brief  The internal function is used to erase the block after the
+  * 		current one and write its header, worn out or failing blocks
+  * 		are skipped
+  * @retval status in OK = 1, No usable block = 0
+  * @param  Log		Log HandleTypedef
+  * @param  Stamp	Base tick of the block
+  */
+static uint8_t DS18B20_Log_Next(DS18B20_Log_t *Log, uint32_t Stamp)
+{
+	DS18B20_LogHdr_t h;
+	uint32_t hdr = DS18B20_LOG_AREA(sizeof(h), Log->Unit);
+	uint32_t erases;
+	uint16_t b;
+
+	for (uint16_t n = 0; n < Log->BlockCnt; n++)
+	{
+		/* Oldest block first, every block is erased in turn */
+		b = (Log->Cur + 1 + n) % Log->BlockCnt;
+		erases = 0;
+		if (Log->Ops->Read(Log, b * Log->BlockSize, (uint8_t *)&h,
+				sizeof(h)) && DS18B20_Log_HdrValid(&h))
+		{
+			erases = h.Erases;
+		}
+		if (Log->MaxErase && erases >= Log->MaxErase) continue;
+		if (!Log->Ops->Erase(Log, b))
+		{
+			Log->Failed++;
+			continue;
+		}
+
+		h.Magic = DS18B20_LOG_MAGIC;
+		h.Seq = Log->Seq + 1;
+		h.Erases = erases + 1;
+		h.BaseTick = Stamp;
+		h.Channels = Log->Channels;
+		h.Unit = Log->Unit;
+		h.Crc = DS18B20_Log_Crc(0, (const uint8_t *)&h,
+				offsetof(DS18B20_LogHdr_t, Crc));
+		memset(Log->Chunk, DS18B20_LOG_ERASED, hdr);
+		memcpy(Log->Chunk, &h, sizeof(h));
+		if (!Log->Ops->Program(Log, b * Log->BlockSize, Log->Chunk, hdr))
+		{
+			Log->Failed++;
+			continue;
+		}
+
+		Log->Cur = b;
+		Log->Seq = h.Seq;
+		Log->Pos = hdr;
+		Log->Fill = 0;
+		Log->Crc = 0;
+		Log->LastCh = 0;
+		Log->Open = 1;
+		Log->Blocks++;
+		for (uint16_t i = 0; i < Log->Channels; i++)
+		{
+			Log->Chan[i].Stamp = Stamp;
+			Log->Chan[i].Interval = 0;
+			Log->Chan[i].Raw = 0;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  The internal function is used to seal the block left open by a
+  * 		reset, its data ends at the last byte programmed
+  * @retval status in OK = 1, Failed = 0
+  * @param  Log		Log HandleTypedef
+  */
+static uint8_t DS18B20_Log_Recover(DS18B20_Log_t *Log)
+{
+	uint32_t base = Log->Cur * Log->BlockSize;
+	uint32_t hdr = DS18B20_LOG_AREA(sizeof(DS18B20_LogHdr_t), Log->Unit);
+	uint32_t off = Log->BlockSize -
+			DS18B20_LOG_AREA(sizeof(DS18B20_LogEnd_t), Log->Unit);
+	uint32_t len = hdr, n, crc = 0;
+
+	/* Records never end on an erased byte */
+	while (off > hdr && len == hdr)
+	{
+		n = (off - hdr > sizeof(Log->Chunk)) ? sizeof(Log->Chunk) : off - hdr;
+		off -= n;
+		if (!Log->Ops->Read(Log, base + off, Log->Chunk, n)) return 0;
+		while (n > 0 && Log->Chunk[n - 1] == DS18B20_LOG_ERASED) n--;
+		if (n > 0) len = DS18B20_LOG_AREA(off + n, Log->Unit);
+	}
+
+	for (off = hdr; off < len; off += n)
+	{
+		n = (len - off > sizeof(Log->Chunk)) ? sizeof(Log->Chunk) : len - off;
+		if (!Log->Ops->Read(Log, base + off, Log->Chunk, n)) return 0;
+		crc = DS18B20_Log_Crc(crc, Log->Chunk, n);
+	}
+
+	Log->Pos = len;
+	Log->Fill = 0;
+	Log->Crc = crc;
+	Log->Open = 1;
+	return DS18B20_Log_Seal(Log);
+}
+
+/**
+  * @brief  The function is used to find the newest block of the log, a
+  * 		block left open is sealed. The next record starts a new block
+  * @retval status in OK = 1, Invalid geometry or flash failure = 0
+  * @param  Log			Log HandleTypedef, Ops and geometry set
+  * @param  Chan		Channel state storage, see DS18B20_LOG_POOL
+  * @param  Channels	Number of channels
+  */
+uint8_t DS18B20_Log_Mount(DS18B20_Log_t *Log, DS18B20_LogChan_t *Chan,
+		uint16_t Channels)
+{
+	DS18B20_LogHdr_t h;
+	DS18B20_LogEnd_t e;
+	uint8_t found = 0;
+
+	if (Log->Unit == 0 || Log->Unit > DS18B20_LOG_UNIT_MAX ||
+			(Log->Unit & (Log->Unit - 1)) != 0 || Log->BlockCnt == 0 ||
+			(Log->BlockSize % Log->Unit) != 0 || Channels == 0)
+	{
+		return 0;
+	}
+	if (Log->BlockSize < DS18B20_LOG_AREA(sizeof(h), Log->Unit) +
+			DS18B20_LOG_AREA(sizeof(e), Log->Unit) + DS18B20_LOG_RECORD_MAX)
+	{
+		return 0;
+	}
+
+	Log->Chan = Chan;
+	Log->Channels = Channels;
+	Log->Cur = Log->BlockCnt - 1;
+	Log->Seq = 0;
+	Log->Open = 0;
+	Log->Fill = 0;
+	Log->Samples = 0;
+	Log->Blocks = 0;
+	Log->Failed = 0;
+
+	/* Newest block, sequence numbers may wrap */
+	for (uint16_t b = 0; b < Log->BlockCnt; b++)
+	{
+		if (!Log->Ops->Read(Log, b * Log->BlockSize, (uint8_t *)&h, sizeof(h)))
+		{
+			return 0;
+		}
+		if (!DS18B20_Log_HdrValid(&h)) continue;
+		if (found && (int32_t)(h.Seq - Log->Seq) <= 0) continue;
+
+		Log->Seq = h.Seq;
+		Log->Cur = b;
+		found = 1;
+	}
+	if (!found) return 1;
+
+	if (!Log->Ops->Read(Log, (Log->Cur + 1) * Log->BlockSize -
+			DS18B20_LOG_AREA(sizeof(e), Log->Unit), (uint8_t *)&e, sizeof(e)))
+	{
+		return 0;
+	}
+	return (e.Len == DS18B20_LOG_OPEN) ? DS18B20_Log_Recover(Log) : 1;
+}
+
+/**
+  * @brief  The function is used to append a sample, a full block is sealed
+  * 		and the oldest one erased for the next
+  * @retval status in OK = 1, Failed = 0
+  * @param  Log			Log HandleTypedef
+  * @param  Channel		Sensor channel, below the mounted channel count
+  * @param  Stamp		HAL tick of the sample
+  * @param  Raw			Temperature in 1/16 degree Celsius
+  */
+uint8_t DS18B20_Log_Append(DS18B20_Log_t *Log, uint16_t Channel,
+		uint32_t Stamp, int16_t Raw)
+{
+	uint8_t rec[DS18B20_LOG_RECORD_MAX];
+	uint32_t end = Log->BlockSize -
+			DS18B20_LOG_AREA(sizeof(DS18B20_LogEnd_t), Log->Unit);
+	DS18B20_LogChan_t *C;
+	uint16_t step;
+	int32_t interval;
+	uint8_t len;
+
+	if (Channel >= Log->Channels) return 0;
+	if (!Log->Open && !DS18B20_Log_Next(Log, Stamp)) return 0;
+
+	for (uint8_t pass = 0; ; pass++)
+	{
+		C = &Log->Chan[Channel];
+		step = (uint16_t)((Channel + Log->Channels - Log->LastCh) %
+				Log->Channels);
+		interval = (int32_t)(Stamp - C->Stamp);
+
+		len = 0;
+		if (step < DS18B20_LOG_STEP_LONG)
+		{
+			rec[len++] = (uint8_t)step;
+		} else {
+			rec[len++] = DS18B20_LOG_STEP_LONG;
+			rec[len++] = (uint8_t)step;
+			rec[len++] = (uint8_t)(step >> 8);
+		}
+		len += DS18B20_Log_PutVar(&rec[len], interval - C->Interval);
+		len += DS18B20_Log_PutVar(&rec[len], (int32_t)Raw - C->Raw);
+
+		if (Log->Pos + Log->Fill + len <= end) break;
+
+		/* Block full, the record starts the next one from scratch */
+		if (pass || !DS18B20_Log_Seal(Log) || !DS18B20_Log_Next(Log, Stamp))
+		{
+			return 0;
+		}
+	}
+
+	for (uint8_t i = 0; i < len; i++)
+	{
+		Log->Chunk[Log->Fill++] = rec[i];
+		if (Log->Fill == Log->Unit && !DS18B20_Log_Program(Log)) return 0;
+	}
+
+	C->Stamp = Stamp;
+	C->Interval = interval;
+	C->Raw = Raw;
+	Log->LastCh = Channel;
+	Log->Samples++;
+	return 1;
+}
+
+/**
+  * @brief  The function is used to program the records not yet on flash,
+  * 		the rest of their unit stays erased
+  * @retval status in OK = 1, Failed = 0
+  * @param  Log			Log HandleTypedef
+  */
+uint8_t DS18B20_Log_Flush(DS18B20_Log_t *Log)
+{
+	if (!Log->Open || Log->Fill == 0) return 1;
+
+	return DS18B20_Log_Program(Log);
+}
+
+/**
+  * @brief  The function is used to close the current block with its data
+  * 		length and CRC, the next record starts a new block
+  * @retval status in OK = 1, Failed = 0
+  * @param  Log			Log HandleTypedef
+  */
+uint8_t DS18B20_Log_Seal(DS18B20_Log_t *Log)
+{
+	DS18B20_LogEnd_t e;
+	uint32_t foot = DS18B20_LOG_AREA(sizeof(e), Log->Unit);
+
+	if (!Log->Open) return 1;
+	if (!DS18B20_Log_Flush(Log)) return 0;
+
+	e.Len = Log->Pos;
+	e.Crc = Log->Crc;
+	memset(Log->Chunk, DS18B20_LOG_ERASED, foot);
+	memcpy(Log->Chunk, &e, sizeof(e));
+	Log->Open = 0;
+	if (!Log->Ops->Program(Log, (Log->Cur + 1) * Log->BlockSize - foot,
+			Log->Chunk, foot))
+	{
+		Log->Failed++;
+		return 0;
+	}
+	return 1;
+}
+
+/**
+  * @brief  The function is used to decode a block read from flash. A sealed
+  * 		block is checked against its CRC, an open one decodes up to its
+  * 		last programmed byte
+  * @retval Number of samples, -1 = invalid block
+  * @param  Block		Block content, 4 byte aligned
+  * @param  Size		Block size in byte
+  * @param  Chan		Channel state storage
+  * @param  Channels	Number of channels Chan holds
+  * @param  Out			Called per sample in log order, NULL = count only
+  * @param  Ctx			Argument of Out
+  */
+int32_t DS18B20_Log_Decode(const uint8_t *Block, uint32_t Size,
+		DS18B20_LogChan_t *Chan, uint16_t Channels, DS18B20_LogOut_t Out,
+		void *Ctx)
+{
+	DS18B20_LogHdr_t h;
+	DS18B20_LogEnd_t e;
+	DS18B20_LogChan_t *C;
+	uint32_t hdr, foot, end, p;
+	int32_t dd, d, cnt = 0;
+	uint16_t ch = 0, step;
+
+	if (Size < sizeof(h)) return -1;
+	memcpy(&h, Block, sizeof(h));
+	if (!DS18B20_Log_HdrValid(&h) || h.Channels > Channels) return -1;
+
+	hdr = DS18B20_LOG_AREA(sizeof(h), h.Unit);
+	foot = DS18B20_LOG_AREA(sizeof(e), h.Unit);
+	if (Size < hdr + foot || (Size % h.Unit) != 0) return -1;
+	memcpy(&e, Block + Size - foot, sizeof(e));
+
+	if (e.Len == DS18B20_LOG_OPEN)
+	{
+		for (end = Size - foot; end > hdr &&
+				Block[end - 1] == DS18B20_LOG_ERASED; end--) {}
+	} else {
+		if (e.Len < hdr || e.Len > Size - foot) return -1;
+		if (DS18B20_Log_Crc(0, Block + hdr, e.Len - hdr) != e.Crc) return -1;
+		end = e.Len;
+	}
+
+	for (uint16_t i = 0; i < h.Channels; i++)
+	{
+		Chan[i].Stamp = h.BaseTick;
+		Chan[i].Interval = 0;
+		Chan[i].Raw = 0;
+	}
+
+	p = hdr;
+	while (p < end)
+	{
+		/* Rest of a flushed unit */
+		if (Block[p] == DS18B20_LOG_ERASED)
+		{
+			p = (p & ~((uint32_t)h.Unit - 1)) + h.Unit;
+			continue;
+		}
+
+		step = Block[p++];
+		if (step == DS18B20_LOG_STEP_LONG)
+		{
+			if (p + 2 > end) return -1;
+			step = Block[p] | ((uint16_t)Block[p + 1] << 8);
+			p += 2;
+		}
+		if (step >= h.Channels) return -1;
+		if (!DS18B20_Log_GetVar(Block, &p, end, &dd) ||
+				!DS18B20_Log_GetVar(Block, &p, end, &d))
+		{
+			return -1;
+		}
+
+		ch = (uint16_t)((ch + step) % h.Channels);
+		C = &Chan[ch];
+		C->Interval += dd;
+		C->Stamp += (uint32_t)C->Interval;
+		C->Raw = (int16_t)(C->Raw + d);
+		if (Out != NULL) Out(Ctx, ch, C->Stamp, C->Raw);
+		cnt++;
+	}
+	return cnt;
+}
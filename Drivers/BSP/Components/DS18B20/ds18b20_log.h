@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_log.h
+  * @brief   This file contains all the constants parameters for the DS18B20
+  * 		 delta encoded flash log
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		The log is a ring of erase blocks on a flash given by Ops, written
+  *		append only. A block starts with a header (sequence number, erase
+  *		count, base tick, CRC) and ends with a footer (data length, CRC)
+  *		programmed when the block is full. In between each sample takes a
+  *		channel step byte, then the change of the sampling interval and
+  *		of the raw temperature of its channel as zigzag varints, about 3
+  *		bytes for a steady sensor. Every block decodes on its own, the
+  *		oldest block is erased for a new one:
+  *
+  *		static DS18B20_LOG_POOL(Log_Pool, DS18B20_POOL_DEFAULT);
+  *		Log.Ops = &QSPI_LogOps;
+  *		Log.BlockSize = 4096;
+  *		Log.BlockCnt = 256;
+  *		Log.Unit = 1;
+  *		DS18B20_Log_Mount(&Log, Log_Pool, DS18B20_POOL_DEFAULT);
+  *		...
+  *		if (DS18B20_ReadRaw(&OW, rom, &raw))
+  *		{
+  *			DS18B20_Log_Append(&Log, ch, HAL_GetTick(), raw);
+  *		}
+  *
+  *		Data is programmed per Unit bytes, the flash word of the device.
+  *		DS18B20_Log_Flush programs a partial unit before a power down. A
+  *		block found unsealed by DS18B20_Log_Mount is sealed, writing goes
+  *		on in the next one. Blocks erased MaxErase times are not used
+  *		again. DS18B20_Log_Decode reads a block back, on target or host.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DS18B20_LOG_H
+#define DS18B20_LOG_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds18b20.h"
+
+/* Data Structure ------------------------------------------------------------*/
+#define DS18B20_LOG_MAGIC			0x314C5344U		/* "DSL1" */
+
+/* Largest program unit (byte), 32 for the STM32H7 flash word */
+#ifndef DS18B20_LOG_UNIT_MAX
+#define DS18B20_LOG_UNIT_MAX		32
+#endif
+
+/* Channel step byte, a longer step follows on 2 bytes. Records never
+ * start with the erased byte, which pads a unit */
+#define DS18B20_LOG_STEP_LONG		0xFE
+#define DS18B20_LOG_ERASED			0xFF
+
+/* Longest record: step, interval change, temperature change */
+#define DS18B20_LOG_RECORD_MAX		(3 + 5 + 3)
+
+typedef struct
+{
+	uint32_t		Magic;
+	uint32_t		Seq;				/* Block number, ascending */
+	uint32_t		Erases;				/* Erase count of the block */
+	uint32_t		BaseTick;			/* HAL tick of the block start */
+	uint16_t		Channels;
+	uint16_t		Unit;				/* Program unit in byte */
+	uint32_t		Crc;				/* CRC-32 of the fields above */
+} DS18B20_LogHdr_t;
+
+typedef struct
+{
+	uint32_t		Len;				/* Data end in block, erased = open */
+	uint32_t		Crc;				/* CRC-32 from header end to Len */
+} DS18B20_LogEnd_t;
+
+/* Encoder and decoder state of a channel, reset at each block start */
+typedef struct
+{
+	uint32_t		Stamp;				/* Tick of last sample */
+	int32_t			Interval;			/* Ticks between last two samples */
+	int16_t			Raw;				/* Last temperature, 1/16 degree */
+	uint16_t		Reserved;
+} DS18B20_LogChan_t;
+
+#define DS18B20_LOG_POOL(Name, Cnt)		DS18B20_LogChan_t Name[Cnt]
+
+typedef struct __DS18B20_Log_t DS18B20_Log_t;
+
+/* Flash access, addresses from the first block of the log. Return OK = 1 */
+typedef struct
+{
+	uint8_t			(*Read)(DS18B20_Log_t *Log, uint32_t Addr, uint8_t *Data,
+						uint32_t Len);
+	uint8_t			(*Program)(DS18B20_Log_t *Log, uint32_t Addr,
+						const uint8_t *Data, uint32_t Len);
+	uint8_t			(*Erase)(DS18B20_Log_t *Log, uint16_t Block);
+} DS18B20_LogOps_t;
+
+/* Sample output of DS18B20_Log_Decode */
+typedef void (*DS18B20_LogOut_t)(void *Ctx, uint16_t Channel, uint32_t Stamp,
+		int16_t Raw);
+
+struct __DS18B20_Log_t
+{
+	const DS18B20_LogOps_t *Ops;
+	void			*Ctx;				/* Flash of the Ops */
+	uint32_t		BlockSize;			/* Erase unit in byte */
+	uint16_t		BlockCnt;
+	uint16_t		Unit;				/* Program unit, 1 - LOG_UNIT_MAX */
+	uint32_t		MaxErase;			/* Block wear limit, 0 = none */
+	DS18B20_LogChan_t *Chan;
+	uint16_t		Channels;
+	uint16_t		Cur;				/* Block written */
+	uint16_t		LastCh;				/* Channel of the last record */
+	uint8_t			Open;				/* Cur takes records */
+	uint32_t		Seq;				/* Sequence number of Cur */
+	uint32_t		Pos;				/* Chunk offset in block */
+	uint16_t		Fill;				/* Bytes in chunk */
+	uint32_t		Crc;				/* Running CRC of data programmed */
+	uint8_t			Chunk[DS18B20_LOG_UNIT_MAX];
+	uint32_t		Samples;
+	uint32_t		Blocks;				/* Blocks opened */
+	uint32_t		Failed;				/* Program or erase failures */
+};
+
+/* External Function ---------------------------------------------------------*/
+uint8_t DS18B20_Log_Mount(DS18B20_Log_t *Log, DS18B20_LogChan_t *Chan,
+		uint16_t Channels);
+uint8_t DS18B20_Log_Append(DS18B20_Log_t *Log, uint16_t Channel,
+		uint32_t Stamp, int16_t Raw);
+uint8_t DS18B20_Log_Flush(DS18B20_Log_t *Log);
+uint8_t DS18B20_Log_Seal(DS18B20_Log_t *Log);
+int32_t DS18B20_Log_Decode(const uint8_t *Block, uint32_t Size,
+		DS18B20_LogChan_t *Chan, uint16_t Channels, DS18B20_LogOut_t Out,
+		void *Ctx);
+uint32_t DS18B20_Log_Crc(uint32_t Crc, const uint8_t *Data, uint32_t Len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS18B20_LOG_H */
@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_ring.c
+  * @brief   This file includes the per device sample rings for DS18B20,
+  * 		 lock-free between one producer and one consumer
+  ******************************************************************************
+  */
+#include "ds18b20_ring.h"
+#include <string.h>
+
+#define DS18B20_RING_MASK		(DS18B20_RING_DEPTH - 1)
+
+/**
+  * @brief  The function is used to give the registry its sample rings, all
+  * 		rings are emptied. Call it after DS18B20_SetPool, before the
+  * 		consumer runs
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Rings		Ring storage
+  * @param  Cnt			Number of rings
+  */
+void DS18B20_Ring_Attach(DS18B20_Drv_t *DS, DS18B20_Ring_t *Rings,
+		uint16_t Cnt)
+{
+	memset(Rings, 0, Cnt * sizeof(Rings[0]));
+	for (uint16_t i = 0; i < DS->Cnt; i++)
+	{
+		DS->Ring[i] = DS18B20_RING_NONE;
+	}
+	DS->Rings = Rings;
+	DS->RingCnt = Cnt;
+	DS->RingMiss = 0;
+}
+
+/**
+  * @brief  The internal function is used to give a device a ring, its own
+  * 		one from before a DS18B20_Init or else a drained ring no
+  * 		registered device owns
+  * @retval Ring found = 1, None free = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Idx			Device index in registry
+  */
+static uint8_t DS18B20_Ring_Map(DS18B20_Drv_t *DS, uint16_t Idx)
+{
+	uint64_t key = DS->Rom[Idx];
+	uint16_t spare = DS18B20_RING_NONE;
+	DS18B20_Ring_t *R;
+
+	for (uint16_t j = 0; j < DS->RingCnt; j++)
+	{
+		R = &DS->Rings[j];
+		if (R->Rom == key)
+		{
+			DS->Ring[Idx] = j;
+			return 1;
+		}
+		if (spare == DS18B20_RING_NONE && R->Head == R->Tail &&
+				(R->Rom == 0 || DS18B20_Find(DS, (const uint8_t *)&R->Rom) < 0))
+		{
+			spare = j;
+		}
+	}
+	if (spare == DS18B20_RING_NONE) return 0;
+
+	/* Empty ring, the consumer sees the new ROM with the first sample */
+	DS->Rings[spare].Rom = key;
+	__DMB();
+	DS->Ring[Idx] = spare;
+	return 1;
+}
+
+/**
+  * @brief  The function is used to push a sample to the ring of a device,
+  * 		producer side. Never blocks, a full ring drops the sample
+  * @retval Pushed = 1, No ring or ring full = 0
+  * @param  DS			DS18B20 HandleTypedef
+  * @param  Idx			Device index in registry
+  * @param  Stamp		HAL tick of the read
+  * @param  Raw			Temperature in 1/16 degree Celsius
+  * @param  Status		DS18B20_STAT_VALID or DS18B20_STAT_FAULT, ALARM
+  */
+uint8_t DS18B20_Ring_Push(DS18B20_Drv_t *DS, uint16_t Idx, uint32_t Stamp,
+		int16_t Raw, uint8_t Status)
+{
+	DS18B20_Ring_t *R;
+	DS18B20_Sample_t *S;
+	uint32_t head;
+
+	if (DS->Rings == NULL) return 0;
+	if (DS->Ring[Idx] == DS18B20_RING_NONE && !DS18B20_Ring_Map(DS, Idx))
+	{
+		DS->RingMiss++;
+		return 0;
+	}
+
+	R = &DS->Rings[DS->Ring[Idx]];
+	head = R->Head;
+	if ((head - R->Tail) >= DS18B20_RING_DEPTH)
+	{
+		R->Dropped++;
+		return 0;
+	}
+
+	S = &R->Buf[head & DS18B20_RING_MASK];
+	S->Stamp = Stamp;
+	S->Raw = Raw;
+	S->Status = Status;
+	S->Reserved = 0;
+
+	/* Sample written before it is published */
+	__DMB();
+	R->Head = head + 1;
+	return 1;
+}
+
+/**
+  * @brief  The function is used to drain up to Max samples of a ring,
+  * 		oldest first, consumer side
+  * @retval Number of samples copied
+  * @param  R			Sample ring
+  * @param  ROM			ROM number of the samples, 8 bytes, NULL = unused
+  * @param  Dst			Destination, Max samples
+  * @param  Max			Batch size
+  */
+uint16_t DS18B20_Ring_Read(DS18B20_Ring_t *R, uint8_t *ROM,
+		DS18B20_Sample_t *Dst, uint16_t Max)
+{
+	uint32_t tail = R->Tail;
+	uint32_t cnt = R->Head - tail;
+
+	/* Samples and ROM read after the head that published them */
+	__DMB();
+	if (cnt > Max) cnt = Max;
+	if (cnt == 0) return 0;
+	if (ROM != NULL) memcpy(ROM, (const void *)&R->Rom, 8);
+
+	for (uint32_t i = 0; i < cnt; i++)
+	{
+		Dst[i] = R->Buf[(tail + i) & DS18B20_RING_MASK];
+	}
+
+	/* Slots copied before they are given back */
+	__DMB();
+	R->Tail = tail + cnt;
+	return (uint16_t)cnt;
+}
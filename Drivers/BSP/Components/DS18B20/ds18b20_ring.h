@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_ring.h
+  * @brief   This file contains all the constants parameters for the DS18B20
+  * 		 per device sample rings
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Each ring is a single producer, single consumer queue of samples
+  *		(tick, raw temperature, status) of one device. DS18B20_TryRead, so
+  *		the acquisition engine, pushes every read and every timeout
+  *		without blocking, a full ring drops the new sample. One other task
+  *		or interrupt drains the rings in batches, without lock:
+  *
+  *		static DS18B20_Ring_t Rings[DS18B20_POOL_DEFAULT];
+  *		DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+  *		DS18B20_Ring_Attach(&DS, Rings, DS18B20_POOL_DEFAULT);
+  *		...
+  *		for (uint16_t i = 0; i < DS18B20_POOL_DEFAULT; i++)
+  *		{
+  *			n = DS18B20_Ring_Read(&Rings[i], rom, Samples, 8);
+  *		}
+  *
+  *		A device gets a ring at its first sample and keeps it while it is
+  *		registered, registry indexes may change meanwhile. The ring of a
+  *		removed device is given to a new one once drained, so the consumer
+  *		takes the ROM number from each batch.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DS18B20_RING_H
+#define DS18B20_RING_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds18b20.h"
+
+/* Data Structure ------------------------------------------------------------*/
+/* Samples per ring, power of two */
+#ifndef DS18B20_RING_DEPTH
+#define DS18B20_RING_DEPTH		16
+#endif
+#if (DS18B20_RING_DEPTH & (DS18B20_RING_DEPTH - 1)) != 0
+#error "DS18B20_RING_DEPTH must be a power of two"
+#endif
+
+/* Device without a ring */
+#define DS18B20_RING_NONE		0xFFFFU
+
+typedef struct
+{
+	uint32_t		Stamp;				/* HAL tick of the read */
+	int16_t			Raw;				/* 1/16 degree Celsius, 0 on fault */
+	uint8_t			Status;				/* STAT_VALID or STAT_FAULT, ALARM */
+	uint8_t			Reserved;
+} DS18B20_Sample_t;
+
+typedef struct __DS18B20_Ring_t
+{
+	uint64_t		Rom;				/* ROM key of the device, 0 = free */
+	__IO uint32_t	Head;				/* Pushed, written by producer only */
+	__IO uint32_t	Tail;				/* Read, written by consumer only */
+	uint32_t		Dropped;			/* Samples lost with the ring full */
+	DS18B20_Sample_t Buf[DS18B20_RING_DEPTH];
+} DS18B20_Ring_t;
+
+/* External Function ---------------------------------------------------------*/
+void DS18B20_Ring_Attach(DS18B20_Drv_t *DS, DS18B20_Ring_t *Rings,
+		uint16_t Cnt);
+uint8_t DS18B20_Ring_Push(DS18B20_Drv_t *DS, uint16_t Idx, uint32_t Stamp,
+		int16_t Raw, uint8_t Status);
+uint16_t DS18B20_Ring_Read(DS18B20_Ring_t *R, uint8_t *ROM,
+		DS18B20_Sample_t *Dst, uint16_t Max);
+
+/**
+  * @brief  The function is used to get the number of samples waiting, from
+  * 		either side
+  * @retval Samples in ring
+  * @param  R		Sample ring
+  */
+static inline uint16_t DS18B20_Ring_Count(const DS18B20_Ring_t *R)
+{
+	return (uint16_t)(R->Head - R->Tail);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS18B20_RING_H */
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_snap.c
+  * @brief   This file includes the latest value snapshot for DS18B20, a
+  * 		 double buffer with sequence numbers read without lock
+  ******************************************************************************
+  */
+#include "ds18b20_snap.h"
+#include <string.h>
+
+/**
+  * @brief  The function is used to initialize an empty snapshot
+  * @param  Snap		Snapshot HandleTypedef
+  * @param  Pool		Storage, see DS18B20_SNAP_POOL
+  * @param  Cnt			Devices per buffer, half the storage entries
+  */
+void DS18B20_Snap_Init(DS18B20_Snap_t *Snap, DS18B20_SnapDev_t *Pool,
+		uint16_t Cnt)
+{
+	memset(Snap, 0, sizeof(*Snap));
+	Snap->Buf[0].Dev = Pool;
+	Snap->Buf[1].Dev = Pool + Cnt;
+	Snap->Size = Cnt;
+}
+
+/**
+  * @brief  The function is used to publish every registered device at once,
+  * 		writer side. Only one context may publish a snapshot
+  * @param  Snap		Snapshot HandleTypedef
+  * @param  DS			DS18B20 HandleTypedef
+  */
+void DS18B20_Snap_Publish(DS18B20_Snap_t *Snap, DS18B20_Drv_t *DS)
+{
+	DS18B20_SnapBuf_t *B = &Snap->Buf[Snap->Latest ^ 1];
+	uint16_t cnt = DS->Cnt;
+
+	if (cnt > Snap->Size)
+	{
+		cnt = Snap->Size;
+		Snap->Truncated++;
+	}
+
+	/* Readers of this buffer are from two publishes ago, they start over */
+	B->Seq++;
+	__DMB();
+
+	for (uint16_t i = 0; i < cnt; i++)
+	{
+		B->Dev[i].Rom = DS->Rom[i];
+		B->Dev[i].Stamp = DS->Stamp[i];
+		B->Dev[i].Temperature = DS->Temperature[i];
+		B->Dev[i].Status = DS->Status[i];
+	}
+	B->Cnt = cnt;
+	B->Cycle = ++Snap->Cycle;
+	B->Stamp = HAL_GetTick();
+
+	/* Buffer complete before it is marked and shown */
+	__DMB();
+	B->Seq++;
+	__DMB();
+	Snap->Latest ^= 1;
+}
+
+/**
+  * @brief  The function is used to copy the latest snapshot, reader side.
+  * 		Any number of contexts may read
+  * @retval Number of devices copied, 0 = nothing published yet
+  * @param  Snap		Snapshot HandleTypedef
+  * @param  Dst			Destination, Max devices
+  * @param  Max			Devices Dst holds
+  * @param  Cycle		Publish number of the copy, NULL = unused
+  */
+uint16_t DS18B20_Snap_Read(DS18B20_Snap_t *Snap, DS18B20_SnapDev_t *Dst,
+		uint16_t Max, uint32_t *Cycle)
+{
+	const DS18B20_SnapBuf_t *B;
+	uint32_t seq, cycle;
+	uint16_t cnt;
+
+	do
+	{
+		B = &Snap->Buf[Snap->Latest];
+		seq = B->Seq;
+		__DMB();
+
+		cnt = (B->Cnt > Max) ? Max : B->Cnt;
+		memcpy(Dst, B->Dev, cnt * sizeof(Dst[0]));
+		cycle = B->Cycle;
+
+		/* Copy done before the sequence is checked again */
+		__DMB();
+	} while ((seq & 1) || B->Seq != seq);
+
+	if (Cycle != NULL) *Cycle = cycle;
+	return cnt;
+}
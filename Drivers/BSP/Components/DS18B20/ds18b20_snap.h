@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    ds18b20_snap.h
+  * @brief   This file contains all the constants parameters for the DS18B20
+  * 		 latest value snapshot
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		The snapshot holds the temperature and status of every device of a
+  *		bus as of the end of an acquisition cycle, once every group was
+  *		read. Two buffers are used in turn, each with a sequence number
+  *		that is odd while it is written. DS18B20_Snap_Publish writes the
+  *		buffer readers are not pointed to, then points them to it.
+  *		DS18B20_Snap_Read copies the latest one and starts over only if a
+  *		second publish reused it meanwhile, without lock or interrupt
+  *		masking. A reader in an interrupt never starts over.
+  *
+  *		static DS18B20_SNAP_POOL(Snap_Pool, DS18B20_POOL_DEFAULT);
+  *		DS18B20_Snap_Init(&Snap, Snap_Pool, DS18B20_POOL_DEFAULT);
+  *		DS18B20_Acq_SetSnapshot(&Acq, &DS, &Snap);
+  *		...
+  *		cnt = DS18B20_Snap_Read(&Snap, Dev, DS18B20_POOL_DEFAULT, &cycle);
+  *
+  *		Without the acquisition engine call DS18B20_Snap_Publish once all
+  *		devices are read.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DS18B20_SNAP_H
+#define DS18B20_SNAP_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds18b20.h"
+
+/* Data Structure ------------------------------------------------------------*/
+typedef struct
+{
+	uint64_t		Rom;				/* ROM number as key */
+	uint32_t		Stamp;				/* Tick of last sample */
+	DS18B20_Temp_t	Temperature;
+	uint8_t			Status;				/* DS18B20_STAT_xxx */
+} DS18B20_SnapDev_t;
+
+/* Storage of a snapshot of Cnt devices, two buffers */
+#define DS18B20_SNAP_POOL(Name, Cnt)	DS18B20_SnapDev_t Name[2 * (Cnt)]
+
+typedef struct
+{
+	__IO uint32_t	Seq;				/* Odd while written */
+	uint32_t		Cycle;				/* Publish number */
+	uint32_t		Stamp;				/* Tick of publish */
+	uint16_t		Cnt;
+	DS18B20_SnapDev_t *Dev;
+} DS18B20_SnapBuf_t;
+
+typedef struct
+{
+	DS18B20_SnapBuf_t Buf[2];
+	__IO uint8_t	Latest;				/* Buffer readers copy */
+	uint16_t		Size;				/* Devices per buffer */
+	uint32_t		Cycle;				/* Cycles published */
+	uint32_t		Truncated;			/* Publishes with devices left out */
+} DS18B20_Snap_t;
+
+/* External Function ---------------------------------------------------------*/
+void DS18B20_Snap_Init(DS18B20_Snap_t *Snap, DS18B20_SnapDev_t *Pool,
+		uint16_t Cnt);
+void DS18B20_Snap_Publish(DS18B20_Snap_t *Snap, DS18B20_Drv_t *DS);
+uint16_t DS18B20_Snap_Read(DS18B20_Snap_t *Snap, DS18B20_SnapDev_t *Dst,
+		uint16_t Max, uint32_t *Cycle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS18B20_SNAP_H */
@@ -6,14 +6,15 @@
   */
 #include "dwt.h"
 
-static uint32_t SysCClk, start;
+uint32_t DwtCycUs;
+static uint32_t start;
 
 /**
   * @brief  Initialize DWT
   */
 void DwtInit(void)
 {
-	SysCClk 		= (SystemCoreClock / 1000000);	// Calculate in us
+	DwtCycUs 		= (SystemCoreClock / 1000000);	// Calculate in us
 	DWT_LAR			|= DWT_LAR_UNLOCK;
 	DEM_CR			|= (uint32_t)DEM_CR_TRCENA;
 	DWT_CYCCNT		= (uint32_t)0u;					// Reset the clock counter
@@ -21,7 +22,7 @@ void DwtInit(void)
 }
 
 /**
-  * @brief  Start DWT Counter
+  * @brief  Start DWT Counter, one interval at a time
   */
 void DwtStart(void)
 {
@@ -34,7 +35,7 @@ void DwtStart(void)
   */
 float DwtInterval(void)
 {
-	return (float)(DWT_CYCCNT - start) / SysCClk;
+	return (float)(DWT_CYCCNT - start) / DwtCycUs;
 }
 
 /**
@@ -43,8 +44,8 @@ float DwtInterval(void)
   */
 inline void DwtDelay_us(uint32_t usec)
 {
-	start = DWT_CYCCNT;
-	while(((DWT_CYCCNT - start) / SysCClk) < usec) {};
+	/* Own deadline per call, delays may run in several tasks */
+	DwtWaitUntil(DwtDeadline_us(DWT_CYCCNT, usec));
 }
 
 /**
@@ -53,6 +54,12 @@ inline void DwtDelay_us(uint32_t usec)
   */
 inline void DwtDelay_ms(uint32_t msec)
 {
-	start = DWT_CYCCNT;
-	while(((DWT_CYCCNT - start) / SysCClk) < (msec * 1000)) {};
+	uint32_t deadline = DWT_CYCCNT;
+
+	/* One millisecond per deadline, long delays stay below 2^31 cycles */
+	while (msec--)
+	{
+		deadline = DwtDeadline_us(deadline, 1000);
+		DwtWaitUntil(deadline);
+	}
 }
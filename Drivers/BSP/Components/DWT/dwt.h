@@ -19,11 +19,20 @@
 #define  DWT_LAR_UNLOCK		(uint32_t)0xC5ACCE55
 #define  DEM_CR_TRCENA		(1 << 24)
 #define  DWT_CR_CYCCNTENA	(1 <<  0)
+
+/* Registers may be provided by main.h, e.g. in the host simulator build */
+#ifndef DWT_CYCCNT
 #define  DWT_CR				*(volatile uint32_t *)0xE0001000
 #define  DWT_LAR			*(volatile uint32_t *)0xE0001FB0
 #define  DWT_CYCCNT			*(volatile uint32_t *)0xE0001004
 #define  DEM_CR				*(volatile uint32_t *)0xE000EDFC
+#endif
+
 
+/* Cycles per microsecond, set by DwtInit */
+extern uint32_t DwtCycUs;
+
+#define  DWT_CYCLES(us)		((uint32_t)(us) * DwtCycUs)
 
 /* External Function ---------------------------------------------------------*/
 void DwtInit(void);
@@ -32,6 +41,46 @@ float DwtInterval(void);
 void DwtDelay_us(uint32_t usec);
 void DwtDelay_ms(uint32_t msec);
 
+/**
+  * @brief  Current cycle count, the time base of the deadlines
+  * @retval DWT_CYCCNT
+  */
+static inline uint32_t DwtNow(void)
+{
+	return DWT_CYCCNT;
+}
+
+/**
+  * @brief  Deadline a number of microseconds after a time, chains edges
+  * 		from one anchor without adding up the call overhead
+  * @retval Deadline in cycles
+  * @param	From	Time in cycles, e.g. DwtNow or a previous deadline
+  * @param	usec	Period in microsecond, below 2^31 cycles
+  */
+static inline uint32_t DwtDeadline_us(uint32_t From, uint32_t usec)
+{
+	return From + DWT_CYCLES(usec);
+}
+
+/**
+  * @brief  Check a deadline, safe over the 32 bit wraparound
+  * @retval Passed = 1, Ahead = 0
+  * @param	Deadline	Deadline in cycles, less than 2^31 cycles away
+  */
+static inline uint8_t DwtExpired(uint32_t Deadline)
+{
+	return ((int32_t)(DWT_CYCCNT - Deadline) >= 0) ? 1 : 0;
+}
+
+/**
+  * @brief  Wait until a deadline, safe over the 32 bit wraparound
+  * @param	Deadline	Deadline in cycles, less than 2^31 cycles away
+  */
+static inline void DwtWaitUntil(uint32_t Deadline)
+{
+	while ((int32_t)(DWT_CYCCNT - Deadline) < 0) {};
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,36 +1,267 @@
 /**
   ******************************************************************************
   * @file    onewire.c
-  * @brief   This file includes the HAL/LL driver for OneWire devices
+  * @brief   This file includes the HAL/LL driver for OneWire devices and
+  * 		 the bus driver dispatch
   ******************************************************************************
   */
 #include "onewire.h"
+#include <string.h>
 
 /**
   * @brief  The internal function is used as gpio pin mode
   * @param  OW		OneWire HandleTypedef
   * @param  Mode	Input or Output
   */
-static void OneWire_Pin_Mode(OneWire_t* OW, PinMode Mode)
+static void OneWire_HAL_SetMode(OneWire_t* OW, PinMode Mode)
 {
-#ifdef LL_Driver
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = OW->DataPin;
 	if(Mode == Input)
 	{
-		LL_GPIO_SetPinMode(OW->DataPort, OW->DataPin, LL_GPIO_MODE_INPUT);
+		GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
 	}else{
-		LL_GPIO_SetPinMode(OW->DataPort, OW->DataPin, LL_GPIO_MODE_OUTPUT);
+		GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
 	}
-#else
+	HAL_GPIO_Init(OW->DataPort, &GPIO_InitStruct);
+}
+
+/**
+  * @brief  The internal function is used as gpio pin level
+  * @param  OW		OneWire HandleTypedef
+  * @param  Mode	Level: Set/High = 1, Reset/Low = 0
+  */
+static void OneWire_HAL_SetLevel(OneWire_t* OW, uint8_t Level)
+{
+	HAL_GPIO_WritePin(OW->DataPort, OW->DataPin, Level);
+}
+
+/**
+  * @brief  The internal function is used to read data pin
+  * @retval Pin level status
+  * @param  OW		OneWire HandleTypedef
+  */
+static uint8_t OneWire_HAL_GetLevel(OneWire_t* OW)
+{
+	return HAL_GPIO_ReadPin(OW->DataPort, OW->DataPin);
+}
+
+const OneWire_Ops_t OneWire_HAL_Ops =
+{
+	.SetMode	= OneWire_HAL_SetMode,
+	.SetLevel	= OneWire_HAL_SetLevel,
+	.GetLevel	= OneWire_HAL_GetLevel,
+	.Reset		= OneWire_BB_Reset,
+	.WriteBits	= OneWire_BB_WriteBits,
+	.ReadBits	= OneWire_BB_ReadBits,
+	.Xfer		= NULL
+};
+
+/**
+  * @brief  The internal function is used as gpio pin mode, the open-drain
+  * 		pin stays output and is released by writing 1
+  * @param  OW		OneWire HandleTypedef
+  * @param  Mode	Input or Output
+  */
+static void OneWire_OD_SetMode(OneWire_t* OW, PinMode Mode)
+{
+	if (Mode == Input)
+	{
+		OW->DataPort->BSRR = OW->DataPin;
+	}
+}
+
+/**
+  * @brief  The internal function is used as gpio pin level
+  * @param  OW		OneWire HandleTypedef
+  * @param  Mode	Level: Set/High = 1, Reset/Low = 0
+  */
+static void OneWire_OD_SetLevel(OneWire_t* OW, uint8_t Level)
+{
+	OW->DataPort->BSRR = Level ? OW->DataPin : OW->BsrrLow;
+}
+
+/**
+  * @brief  The internal function is used to read data pin
+  * @retval Pin level status
+  * @param  OW		OneWire HandleTypedef
+  */
+static uint8_t OneWire_OD_GetLevel(OneWire_t* OW)
+{
+	return ((OW->DataPort->IDR & OW->DataPin) != 0x00U) ? 1 : 0;
+}
+
+/**
+  * @brief  The internal function is used to reset device, one BSRR write
+  * 		per edge and one IDR read
+  * @retval Line level at sample time, 0 = presence
+  * @param  OW		OneWire HandleTypedef
+  */
+static uint8_t OneWire_OD_Reset(OneWire_t* OW)
+{
+	GPIO_TypeDef *port = OW->DataPort;
+	uint32_t primask, begin, end;
+	uint8_t rslt, late, retry = ONEWIRE_RESET_RETRY;
+
+	do
+	{
+		/* Line low, and wait 480us */
+		port->BSRR = OW->BsrrLow;
+		OneWire_OS_Delay_us(480);
+
+		/* Release line and wait for 70us */
+		primask = OneWire_SlotMask(&begin);
+		port->BSRR = OW->DataPin;
+		OneWire_SlotUnmask(&OW->Timing, primask, begin);
+		DwtWaitUntil(DwtDeadline_us(begin, 70));
+
+		/* Check bit value */
+		primask = OneWire_SlotMask(&end);
+		rslt = ((port->IDR & OW->DataPin) != 0x00U) ? 1 : 0;
+		OneWire_SlotUnmask(&OW->Timing, primask, end);
+		late = OneWire_SlotCheck(&OW->Timing, end - begin,
+				ONEWIRE_PRESENCE_MAX);
+
+		/* Delay for 410 us, the line is idle */
+		OneWire_OS_Delay_us(410);
+
+		/* High sampled after the presence pulse could have ended, again */
+	} while (late && rslt && --retry);
+
+	return rslt;
+}
+
+/**
+  * @brief  The internal function is used to write bits, one BSRR write per
+  * 		edge
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Bits to write, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_OD_WriteBits(OneWire_t* OW, const uint8_t *Data,
+		uint16_t Bits)
+{
+	GPIO_TypeDef *port = OW->DataPort;
+	uint32_t high = OW->DataPin, low = OW->BsrrLow;
+	uint32_t primask, begin, end;
+
+	for (uint16_t i = 0; i < Bits; i++)
+	{
+		if ((Data[i >> 3] >> (i & 7)) & 0x01)
+		{
+			/* Low 10 us, masked as a late release writes 0 */
+			primask = OneWire_SlotMask(&begin);
+			port->BSRR = low;
+			DwtWaitUntil(DwtDeadline_us(begin, 10));
+			port->BSRR = high;
+			OneWire_SlotCheck(&OW->Timing, OneWire_SlotUnmask(&OW->Timing,
+					primask, begin), ONEWIRE_W1_LOW_MAX);
+
+			/* Released to the end of the 65 us slot */
+			DwtWaitUntil(DwtDeadline_us(begin, 65));
+		} else {
+			/* Low 65 us, only the edges are masked */
+			primask = OneWire_SlotMask(&begin);
+			port->BSRR = low;
+			OneWire_SlotUnmask(&OW->Timing, primask, begin);
+			DwtWaitUntil(DwtDeadline_us(begin, 65));
+			primask = OneWire_SlotMask(&end);
+			port->BSRR = high;
+			OneWire_SlotUnmask(&OW->Timing, primask, end);
+			OneWire_SlotCheck(&OW->Timing, end - begin, ONEWIRE_W0_LOW_MAX);
+
+			/* Released to the end of the 70 us slot */
+			DwtWaitUntil(DwtDeadline_us(begin, 70));
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to read bits, one BSRR write per
+  * 		edge and one IDR read per bit
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Buffer for bits read, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_OD_ReadBits(OneWire_t* OW, uint8_t *Data, uint16_t Bits)
+{
+	GPIO_TypeDef *port = OW->DataPort;
+	uint32_t high = OW->DataPin, low = OW->BsrrLow;
+	uint32_t primask, begin, idr;
+
+	for (uint16_t i = 0; i < (Bits + 7) / 8; i++)
+	{
+		Data[i] = 0;
+	}
+	for (uint16_t i = 0; i < Bits; i++)
+	{
+		/* Low 3 us, release and sample at 13 us, masked to the sample */
+		primask = OneWire_SlotMask(&begin);
+		port->BSRR = low;
+		DwtWaitUntil(DwtDeadline_us(begin, 3));
+		port->BSRR = high;
+		DwtWaitUntil(DwtDeadline_us(begin, 13));
+		idr = port->IDR;
+		OneWire_SlotCheck(&OW->Timing, OneWire_SlotUnmask(&OW->Timing,
+				primask, begin), ONEWIRE_SAMPLE_MAX);
+		if (idr & high)
+		{
+			Data[i >> 3] |= 1 << (i & 7);
+		}
+
+		/* Complete the 63 us slot */
+		DwtWaitUntil(DwtDeadline_us(begin, 63));
+	}
+}
+
+/**
+  * @brief  The function is used to select the open-drain driver, the pin is
+  * 		set to open-drain output once and never changes mode. Needs an
+  * 		external pull-up, call before OneWire_Init
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_OD_Init(OneWire_t* OW)
+{
 	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	/* Released before the pin turns to output */
+	OW->DataPort->BSRR = OW->DataPin;
+
 	GPIO_InitStruct.Pin = OW->DataPin;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_Init(OW->DataPort, &GPIO_InitStruct);
+
+	OW->BsrrLow = (uint32_t)OW->DataPin << 16;
+	OW->Ops = &OneWire_OD_Ops;
+}
+
+const OneWire_Ops_t OneWire_OD_Ops =
+{
+	.SetMode	= OneWire_OD_SetMode,
+	.SetLevel	= OneWire_OD_SetLevel,
+	.GetLevel	= OneWire_OD_GetLevel,
+	.Reset		= OneWire_OD_Reset,
+	.WriteBits	= OneWire_OD_WriteBits,
+	.ReadBits	= OneWire_OD_ReadBits,
+	.Xfer		= NULL
+};
+
+#ifdef ONEWIRE_LL_ENABLED
+/**
+  * @brief  The internal function is used as gpio pin mode
+  * @param  OW		OneWire HandleTypedef
+  * @param  Mode	Input or Output
+  */
+static void OneWire_LL_SetMode(OneWire_t* OW, PinMode Mode)
+{
 	if(Mode == Input)
 	{
-		GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+		LL_GPIO_SetPinMode(OW->DataPort, OW->DataPin, LL_GPIO_MODE_INPUT);
 	}else{
-		GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+		LL_GPIO_SetPinMode(OW->DataPort, OW->DataPin, LL_GPIO_MODE_OUTPUT);
 	}
-	HAL_GPIO_Init(OW->DataPort, &GPIO_InitStruct);
-#endif
 }
 
 /**
@@ -38,18 +269,14 @@ static void OneWire_Pin_Mode(OneWire_t* OW, PinMode Mode)
   * @param  OW		OneWire HandleTypedef
   * @param  Mode	Level: Set/High = 1, Reset/Low = 0
   */
-static void OneWire_Pin_Level(OneWire_t* OW, uint8_t Level)
+static void OneWire_LL_SetLevel(OneWire_t* OW, uint8_t Level)
 {
-#ifdef LL_Driver
 	if(Level == 1)
 	{
 		LL_GPIO_SetOutputPin(OW->DataPort, OW->DataPin);
 	}else{
 		LL_GPIO_ResetOutputPin(OW->DataPort, OW->DataPin);
 	}
-#else
-	HAL_GPIO_WritePin(OW->DataPort, OW->DataPin, Level);
-#endif
 }
 
 /**
@@ -57,82 +284,210 @@ static void OneWire_Pin_Level(OneWire_t* OW, uint8_t Level)
   * @retval Pin level status
   * @param  OW		OneWire HandleTypedef
   */
-static uint8_t OneWire_Pin_Read(OneWire_t* OW)
+static uint8_t OneWire_LL_GetLevel(OneWire_t* OW)
 {
-#ifdef LL_Driver
 	return ((OW->DataPort->IDR & OW->DataPin) != 0x00U) ? 1 : 0;
-#else
-	return HAL_GPIO_ReadPin(OW->DataPort, OW->DataPin);
-#endif
 }
 
+const OneWire_Ops_t OneWire_LL_Ops =
+{
+	.SetMode	= OneWire_LL_SetMode,
+	.SetLevel	= OneWire_LL_SetLevel,
+	.GetLevel	= OneWire_LL_GetLevel,
+	.Reset		= OneWire_BB_Reset,
+	.WriteBits	= OneWire_BB_WriteBits,
+	.ReadBits	= OneWire_BB_ReadBits,
+	.Xfer		= NULL
+};
+#endif /* ONEWIRE_LL_ENABLED */
+
 /**
   * @brief  The internal function is used to write bit
   * @param  OW		OneWire HandleTypedef
   * @param  bit		bit in 0 or 1
   */
-static void OneWire_WriteBit(OneWire_t* OW, uint8_t bit)
+static void OneWire_BB_WriteBit(OneWire_t* OW, uint8_t bit)
 {
+	const OneWire_Ops_t *ops = OW->Ops;
+	uint32_t primask, begin, end;
+
 	if(bit)
 	{
-		/* Set line low */
-		OneWire_Pin_Level(OW, 0);
-		OneWire_Pin_Mode(OW, Output);
-		DwtDelay_us(10);
+		/* Set line low, masked as a late release writes 0 */
+		primask = OneWire_SlotMask(&begin);
+		ops->SetLevel(OW, 0);
+		ops->SetMode(OW, Output);
+		DwtWaitUntil(DwtDeadline_us(begin, 10));
 
 		/* Bit high */
-		OneWire_Pin_Mode(OW, Input);
+		ops->SetMode(OW, Input);
+		OneWire_SlotCheck(&OW->Timing, OneWire_SlotUnmask(&OW->Timing,
+				primask, begin), ONEWIRE_W1_LOW_MAX);
 
-		/* Wait for 55 us and release the line */
-		DwtDelay_us(55);
-		OneWire_Pin_Mode(OW, Input);
+		/* Wait for the end of the 65 us slot and release the line */
+		DwtWaitUntil(DwtDeadline_us(begin, 65));
+		ops->SetMode(OW, Input);
 	}else{
-		/* Set line low */
-		OneWire_Pin_Level(OW, 0);
-		OneWire_Pin_Mode(OW, Output);
-		DwtDelay_us(65);
+		/* Set line low, only the edges are masked */
+		primask = OneWire_SlotMask(&begin);
+		ops->SetLevel(OW, 0);
+		ops->SetMode(OW, Output);
+		OneWire_SlotUnmask(&OW->Timing, primask, begin);
+		DwtWaitUntil(DwtDeadline_us(begin, 65));
 
 		/* Bit high */
-		OneWire_Pin_Mode(OW, Input);
+		primask = OneWire_SlotMask(&end);
+		ops->SetMode(OW, Input);
+		OneWire_SlotUnmask(&OW->Timing, primask, end);
+		OneWire_SlotCheck(&OW->Timing, end - begin, ONEWIRE_W0_LOW_MAX);
 
-		/* Wait for 5 us and release the line */
-		DwtDelay_us(5);
-		OneWire_Pin_Mode(OW, Input);
+		/* Wait for the end of the 70 us slot and release the line */
+		DwtWaitUntil(DwtDeadline_us(begin, 70));
+		ops->SetMode(OW, Input);
 	}
 }
 
 /**
-  * @brief  The function is used to read bit
+  * @brief  The internal function is used to read bit
   * @retval bit
   * @param  OW		OneWire HandleTypedef
   */
-uint8_t OneWire_ReadBit(OneWire_t* OW)
+static uint8_t OneWire_BB_ReadBit(OneWire_t* OW)
 {
+	const OneWire_Ops_t *ops = OW->Ops;
+	uint32_t primask, begin;
 	uint8_t bit = 0;
 
-	/* Line low */
-	OneWire_Pin_Level(OW, 0);
-	OneWire_Pin_Mode(OW, Output);
-	DwtDelay_us(3);
+	/* Line low, masked until the sample */
+	primask = OneWire_SlotMask(&begin);
+	ops->SetLevel(OW, 0);
+	ops->SetMode(OW, Output);
+	DwtWaitUntil(DwtDeadline_us(begin, 3));
 
-	/* Release line */
-	OneWire_Pin_Mode(OW, Input);
-	DwtDelay_us(10);
+	/* Release line, sample at 13 us */
+	ops->SetMode(OW, Input);
+	DwtWaitUntil(DwtDeadline_us(begin, 13));
 
 	/* Read line value */
-	if (OneWire_Pin_Read(OW))
+	if (ops->GetLevel(OW))
 	{
 		/* Bit is HIGH */
 		bit = 1;
 	}
+	OneWire_SlotCheck(&OW->Timing, OneWire_SlotUnmask(&OW->Timing, primask,
+			begin), ONEWIRE_SAMPLE_MAX);
 
-	/* Wait 50us to complete 60us period */
-	DwtDelay_us(50);
+	/* Complete the 63 us slot */
+	DwtWaitUntil(DwtDeadline_us(begin, 63));
 
 	/* Return bit value */
 	return bit;
 }
 
+/**
+  * @brief  The function is used to reset device with the pin operations
+  * @retval Line level at sample time, 0 = presence
+  * @param  OW		OneWire HandleTypedef
+  */
+uint8_t OneWire_BB_Reset(OneWire_t* OW)
+{
+	const OneWire_Ops_t *ops = OW->Ops;
+	uint32_t primask, begin, end;
+	uint8_t rslt, late, retry = ONEWIRE_RESET_RETRY;
+
+	do
+	{
+		/* Line low, and wait 480us */
+		ops->SetLevel(OW, 0);
+		ops->SetMode(OW, Output);
+		OneWire_OS_Delay_us(480);
+
+		/* Release line and wait for 70us */
+		primask = OneWire_SlotMask(&begin);
+		ops->SetMode(OW, Input);
+		OneWire_SlotUnmask(&OW->Timing, primask, begin);
+		DwtWaitUntil(DwtDeadline_us(begin, 70));
+
+		/* Check bit value */
+		primask = OneWire_SlotMask(&end);
+		rslt = ops->GetLevel(OW);
+		OneWire_SlotUnmask(&OW->Timing, primask, end);
+		late = OneWire_SlotCheck(&OW->Timing, end - begin,
+				ONEWIRE_PRESENCE_MAX);
+
+		/* Delay for 410 us, the line is idle */
+		OneWire_OS_Delay_us(410);
+
+		/* High sampled after the presence pulse could have ended, again */
+	} while (late && rslt && --retry);
+
+	return rslt;
+}
+
+/**
+  * @brief  The function is used to write bits with the pin operations
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Bits to write, LSB first
+  * @param  Bits	Number of bits
+  */
+void OneWire_BB_WriteBits(OneWire_t* OW, const uint8_t *Data, uint16_t Bits)
+{
+	for (uint16_t i = 0; i < Bits; i++)
+	{
+		OneWire_BB_WriteBit(OW, (Data[i >> 3] >> (i & 7)) & 0x01);
+	}
+}
+
+/**
+  * @brief  The function is used to read bits with the pin operations
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Buffer for bits read, LSB first
+  * @param  Bits	Number of bits
+  */
+void OneWire_BB_ReadBits(OneWire_t* OW, uint8_t *Data, uint16_t Bits)
+{
+	for (uint16_t i = 0; i < (Bits + 7) / 8; i++)
+	{
+		Data[i] = 0;
+	}
+	for (uint16_t i = 0; i < Bits; i++)
+	{
+		if (OneWire_BB_ReadBit(OW))
+		{
+			Data[i >> 3] |= 1 << (i & 7);
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to write bit
+  * @param  OW		OneWire HandleTypedef
+  * @param  bit		bit in 0 or 1
+  */
+static void OneWire_WriteBit(OneWire_t* OW, uint8_t bit)
+{
+	ONEWIRE_PROF_BEGIN(OW, prof);
+
+	OW->Ops->WriteBits(OW, &bit, 1);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Bit);
+}
+
+/**
+  * @brief  The function is used to read bit
+  * @retval bit
+  * @param  OW		OneWire HandleTypedef
+  */
+uint8_t OneWire_ReadBit(OneWire_t* OW)
+{
+	uint8_t bit;
+	ONEWIRE_PROF_BEGIN(OW, prof);
+
+	OW->Ops->ReadBits(OW, &bit, 1);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Bit);
+
+	return bit;
+}
+
 /**
   * @brief  The function is used to write byte
   * @param  OW		OneWire HandleTypedef
@@ -140,13 +495,10 @@ uint8_t OneWire_ReadBit(OneWire_t* OW)
   */
 void OneWire_WriteByte(OneWire_t* OW, uint8_t byte)
 {
-	uint8_t bit = 8;
-	/* Write 8 bits */
-	while (bit--) {
-		/* LSB bit is first */
-		OneWire_WriteBit(OW, byte & 0x01);
-		byte >>= 1;
-	}
+	ONEWIRE_PROF_BEGIN(OW, prof);
+
+	OW->Ops->WriteBits(OW, &byte, 8);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Byte);
 }
 
 /**
@@ -156,15 +508,72 @@ void OneWire_WriteByte(OneWire_t* OW, uint8_t byte)
   */
 uint8_t OneWire_ReadByte(OneWire_t* OW)
 {
-	uint8_t bit = 8, byte = 0;
-	while (bit--) {
-		byte >>= 1;
-		byte |= (OneWire_ReadBit(OW) << 7);
-	}
+	uint8_t byte;
+	ONEWIRE_PROF_BEGIN(OW, prof);
+
+	OW->Ops->ReadBits(OW, &byte, 8);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Byte);
 
 	return byte;
 }
 
+/**
+  * @brief  The function is used to write bytes
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Pointer to bytes
+  * @param  Len		Number of bytes
+  */
+void OneWire_WriteBytes(OneWire_t* OW, const uint8_t *Data, uint16_t Len)
+{
+	OneWire_Xfer(OW, Data, Len, NULL, 0);
+}
+
+/**
+  * @brief  The function is used to read bytes
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Buffer for bytes read
+  * @param  Len		Number of bytes
+  */
+void OneWire_ReadBytes(OneWire_t* OW, uint8_t *Data, uint16_t Len)
+{
+	OneWire_Xfer(OW, NULL, 0, Data, Len);
+}
+
+/**
+  * @brief  The function is used to write bytes and then read bytes, drivers
+  * 		with bulk transfer move both in one go. A failed bulk transfer
+  * 		is not replayed, the devices may already have seen part of it:
+  * 		Rx reads as idle line and the caller resets and retries
+  * @retval HAL_OK, HAL_ERROR when the bulk transfer failed
+  * @param  OW		OneWire HandleTypedef
+  * @param  Tx		Bytes to write
+  * @param  TxLen	Number of bytes to write
+  * @param  Rx		Buffer for bytes read
+  * @param  RxLen	Number of bytes to read
+  */
+HAL_StatusTypeDef OneWire_Xfer(OneWire_t* OW, const uint8_t *Tx,
+		uint16_t TxLen, uint8_t *Rx, uint16_t RxLen)
+{
+	const OneWire_Ops_t *ops = OW->Ops;
+	HAL_StatusTypeDef status = HAL_OK;
+	ONEWIRE_PROF_BEGIN(OW, prof);
+
+	if (ops->Xfer == NULL)
+	{
+		if (TxLen) ops->WriteBits(OW, Tx, TxLen * 8);
+		if (RxLen) ops->ReadBits(OW, Rx, RxLen * 8);
+	} else if (ops->Xfer(OW, Tx, TxLen * 8, Rx, RxLen * 8) != HAL_OK) {
+		for (uint16_t i = 0; i < RxLen; i++)
+		{
+			Rx[i] = 0xFF;
+		}
+		status = HAL_ERROR;
+	}
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Byte);
+
+	return status;
+}
+
 /**
   * @brief  The function is used to reset device
   * @retval respond from device
@@ -172,22 +581,50 @@ uint8_t OneWire_ReadByte(OneWire_t* OW)
   */
 uint8_t OneWire_Reset(OneWire_t* OW)
 {
-	/* Line low, and wait 480us */
-	OneWire_Pin_Level(OW, 0);
-	OneWire_Pin_Mode(OW, Output);
-	DwtDelay_us(480);
+	uint8_t rslt;
+	ONEWIRE_PROF_BEGIN(OW, prof);
 
-	/* Release line and wait for 70us */
-	OneWire_Pin_Mode(OW, Input);
-	DwtDelay_us(70);
+	OW->Resets++;
+	rslt = OW->Ops->Reset(OW);
+	ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Reset);
 
-	/* Check bit value */
-	uint8_t rslt = OneWire_Pin_Read(OW);
+	return rslt;
+}
 
-	/* Delay for 410 us */
-	DwtDelay_us(410);
+/**
+  * @brief  The function is used to hold the line high for parasite powered
+  * 		devices during conversion and EEPROM copy, call within 10 us of
+  * 		the last command bit. A GPIO pin is driven push-pull high, an
+  * 		external switch is driven from OneWire_StrongPullupCallback
+  * @param  OW		OneWire HandleTypedef
+  * @param  On		Strong pull-up on = 1, Release = 0
+  */
+void OneWire_StrongPullup(OneWire_t* OW, uint8_t On)
+{
+	if (OW->Ops->SetMode != NULL)
+	{
+		if (On)
+		{
+			OW->Ops->SetLevel(OW, 1);
+			OW->Ops->SetMode(OW, Output);
+		} else {
+			OW->Ops->SetMode(OW, Input);
+		}
+	}
+	OneWire_StrongPullupCallback(OW, On);
+}
 
-	return rslt;
+/**
+  * @brief  The function is called to switch an external strong pull-up, for
+  * 		open-drain pins and pins driven by a peripheral
+  * @param  OW		OneWire HandleTypedef
+  * @param  On		Strong pull-up on = 1, Release = 0
+  */
+__weak void OneWire_StrongPullupCallback(OneWire_t* OW, uint8_t On)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)OW;
+	(void)On;
 }
 
 /**
@@ -202,16 +639,21 @@ uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd)
 	uint8_t rom_byte_number = 0;
 	uint8_t search_result 	= 0;
 	uint8_t rom_byte_mask 	= 1;
+	uint8_t crc8			= 0;
 	uint8_t id_bit, cmp_id_bit, search_direction;
 
 	/* if the last call was not the last one */
 	if (!OW->LastDeviceFlag)
 	{
+		OneWire_OS_Lock(OW);
+		ONEWIRE_PROF_BEGIN(OW, prof);
 		if (OneWire_Reset(OW))
 		{
 			OW->LastDiscrepancy = 0;
 			OW->LastDeviceFlag = 0;
 			OW->LastFamilyDiscrepancy = 0;
+			ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Search);
+			OneWire_OS_Unlock(OW);
 			return 0;
 		}
 
@@ -278,6 +720,9 @@ uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd)
 				 * rom_byte_number and reset mask */
 				if (rom_byte_mask == 0)
 				{
+					/* accumulate the CRC as each ROM byte completes */
+					crc8 = OneWire_CRC8_Update(crc8,
+							OW->RomByte[rom_byte_number]);
 					rom_byte_number++;
 					rom_byte_mask = 1;
 				}
@@ -285,7 +730,7 @@ uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd)
 		} while (rom_byte_number < 8);  /* loop until through all ROM bytes 0-7
 		if the search was successful then */
 
-		if (!(id_bit_number < 65))
+		if (!(id_bit_number < 65) && crc8 == 0)
 		{
 			/* search successful so set LastDiscrepancy, LastDeviceFlag,
 			 * search_result */
@@ -296,6 +741,8 @@ uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd)
 			}
 			search_result = 1;
 		}
+		ONEWIRE_PROF_END(OW, prof, OneWire_Prof_Search);
+		OneWire_OS_Unlock(OW);
 	}
 
 	/* if no device found then reset counters so next 'search' will be like a
@@ -311,6 +758,100 @@ uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd)
 	return search_result;
 }
 
+/**
+  * @brief  The function is used to restart the search from scratch
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_ResetSearch(OneWire_t* OW)
+{
+	OW->LastDiscrepancy = 0;
+	OW->LastDeviceFlag = 0;
+	OW->LastFamilyDiscrepancy = 0;
+}
+
+/**
+  * @brief  The function is used to make the next search find the first
+  * 		device of a family, if any. Following searches go on in order,
+  * 		stop once the ROM family code differs
+  * @param  OW		OneWire HandleTypedef
+  * @param  Family	Family code, e.g. 0x28
+  */
+void OneWire_TargetSetup(OneWire_t* OW, uint8_t Family)
+{
+	OW->RomByte[0] = Family;
+	for (uint8_t i = 1; i < 8; i++)
+	{
+		OW->RomByte[i] = 0;
+	}
+
+	/* Follow the family bits, pick 1 at every later discrepancy */
+	OW->LastDiscrepancy = 64;
+	OW->LastFamilyDiscrepancy = 0;
+	OW->LastDeviceFlag = 0;
+}
+
+/**
+  * @brief  The function is used to make the next search skip the rest of
+  * 		the family of the device found last
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_FamilySkipSetup(OneWire_t* OW)
+{
+	OW->LastDiscrepancy = OW->LastFamilyDiscrepancy;
+	OW->LastFamilyDiscrepancy = 0;
+
+	/* No other family left */
+	if (OW->LastDiscrepancy == 0)
+	{
+		OW->LastDeviceFlag = 1;
+	}
+}
+
+/**
+  * @brief  The function is used to check a device is on the bus with one
+  * 		search pass along its ROM, the search state is kept
+  * @retval Present = 1, Absent = 0
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		Pointer to device ROM
+  */
+uint8_t OneWire_Verify(OneWire_t* OW, const uint8_t *ROM)
+{
+	uint8_t rom[8];
+	uint8_t ld, lfd, ldf;
+	uint8_t ok = 0;
+
+	/* Search state of the handle is borrowed */
+	OneWire_OS_Lock(OW);
+	ld = OW->LastDiscrepancy;
+	lfd = OW->LastFamilyDiscrepancy;
+	ldf = OW->LastDeviceFlag;
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		rom[i] = OW->RomByte[i];
+		OW->RomByte[i] = ROM[i];
+	}
+
+	OW->LastDiscrepancy = 64;
+	OW->LastDeviceFlag = 0;
+
+	/* The search ends on the ROM only if that device answered every bit */
+	if (OneWire_Search(OW, ONEWIRE_CMD_SEARCHROM))
+	{
+		ok = (memcmp(OW->RomByte, ROM, 8) == 0) ? 1 : 0;
+	}
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		OW->RomByte[i] = rom[i];
+	}
+	OW->LastDiscrepancy = ld;
+	OW->LastFamilyDiscrepancy = lfd;
+	OW->LastDeviceFlag = ldf;
+	OneWire_OS_Unlock(OW);
+
+	return ok;
+}
+
 /**
   * @brief  The function is used get ROM full address
   * @param  OW		OneWire HandleTypedef
@@ -329,19 +870,45 @@ void OneWire_GetDevRom(OneWire_t* OW, uint8_t *ROM)
   */
 void OneWire_Init(OneWire_t* OW)
 {
-	OneWire_Pin_Mode(OW, Output);
-	OneWire_Pin_Level(OW, 1);
-	DwtDelay_us(1000);
-	OneWire_Pin_Level(OW, 0);
-	DwtDelay_us(1000);
-	OneWire_Pin_Level(OW, 1);
-	DwtDelay_us(2000);
+	uint32_t pos = POSITION_VAL(OW->DataPin);
+
+	OW->ModerMask = 3U << (pos * 2);
+	OW->ModerOut = 1U << (pos * 2);
+	OW->BsrrLow = (uint32_t)OW->DataPin << 16;
+	OW->Timing.MaskMax = 0;
+	OW->Timing.Overruns = 0;
+
+	/* Bus without driver runs on the gpio pin */
+	if (OW->Ops == NULL)
+	{
+#ifdef LL_Driver
+		OW->Ops = &OneWire_LL_Ops;
+#else
+		OW->Ops = &OneWire_HAL_Ops;
+#endif
+	}
+
+	OneWire_OS_Init(OW);
+	OneWire_OS_Lock(OW);
+
+	if (OW->Ops->SetMode != NULL)
+	{
+		OW->Ops->SetMode(OW, Output);
+		OW->Ops->SetLevel(OW, 1);
+		DwtDelay_us(1000);
+		OW->Ops->SetLevel(OW, 0);
+		DwtDelay_us(1000);
+		OW->Ops->SetLevel(OW, 1);
+		DwtDelay_us(2000);
+	} else {
+		/* Pin belongs to a peripheral, wake up the line with a reset */
+		OneWire_Reset(OW);
+	}
 
 	/* Reset the search state */
-	OW->LastDiscrepancy 		= 0;
-	OW->LastDeviceFlag 			= 0;
-	OW->LastFamilyDiscrepancy 	= 0;
-	OW->RomCnt 					= 0;
+	OneWire_ResetSearch(OW);
+
+	OneWire_OS_Unlock(OW);
 }
 
 /**
@@ -351,35 +918,115 @@ void OneWire_Init(OneWire_t* OW)
   */
 void OneWire_SelectWithPointer(OneWire_t* OW, uint8_t *ROM)
 {
-	OneWire_WriteByte(OW, ONEWIRE_CMD_MATCHROM);
+	uint8_t cmd[9];
 
+	cmd[0] = ONEWIRE_CMD_MATCHROM;
 	for (uint8_t i = 0; i < 8; i++)
 	{
-		OneWire_WriteByte(OW, *(ROM + i));
+		cmd[i + 1] = *(ROM + i);
 	}
+	OneWire_WriteBytes(OW, cmd, 9);
 }
 
+/* Dallas/Maxim CRC8, x^8 + x^5 + x^4 + 1, LSB first */
+#ifdef ONEWIRE_CRC_NIBBLE
+const uint8_t OneWire_CRC8_Lo[16] =
+{
+	0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83,
+	0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41
+};
+const uint8_t OneWire_CRC8_Hi[16] =
+{
+	0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8,
+	0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+#else
+const uint8_t OneWire_CRC8_Table[256] =
+{
+	0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83,
+	0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+	0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E,
+	0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+	0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0,
+	0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+	0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D,
+	0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+	0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5,
+	0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+	0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58,
+	0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+	0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6,
+	0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+	0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B,
+	0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+	0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F,
+	0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+	0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92,
+	0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+	0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C,
+	0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+	0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1,
+	0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+	0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49,
+	0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+	0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4,
+	0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+	0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A,
+	0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+	0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7,
+	0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+#endif
+
 /**
   * @brief  The function is used check CRC
+  * @retval CRC of the bytes, 0 if the last byte is the CRC of the others
   * @param  Addr	Pointer to address
-  * @param  ROM		Number of byte
+  * @param  Len		Number of byte
   */
 uint8_t OneWire_CRC8(uint8_t *Addr, uint8_t Len)
 {
 	uint8_t crc = 0;
-	uint8_t inbyte, i, mix;
 
 	while (Len--)
 	{
-		inbyte = *Addr++;
-
-		for (i = 8; i; i--)
-		{
-			mix = (crc ^ inbyte) & 0x01;
-			crc >>= 1;
-			crc ^= (mix) ? 0x8C : 0;
-			inbyte >>= 1;
-		}
+		crc = OneWire_CRC8_Update(crc, *Addr++);
 	}
 	return crc;
 }
+
+/**
+  * @brief  The function is used to write bytes, then read bytes ending with
+  * 		their CRC. Drivers without bulk transfer check the CRC while the
+  * 		bytes come in and stop at the first byte failing Check
+  * @retval CRC OK = 1, Failed, aborted or bulk transfer failed = 0
+  * @param  OW		OneWire HandleTypedef
+  * @param  Tx		Bytes to write
+  * @param  TxLen	Number of bytes to write
+  * @param  Rx		Buffer for bytes read, last one is the CRC
+  * @param  RxLen	Number of bytes to read
+  * @param  Check	Byte check, NULL for none
+  */
+uint8_t OneWire_XferCRC(OneWire_t* OW, const uint8_t *Tx, uint16_t TxLen,
+		uint8_t *Rx, uint8_t RxLen, OneWire_Check_t Check)
+{
+	const OneWire_Ops_t *ops = OW->Ops;
+	uint8_t crc = 0;
+
+	/* Bulk transfer is already on the bus, no early abort. A failed one
+	 * is not replayed on the addressed devices */
+	if (ops->Xfer != NULL)
+	{
+		if (ops->Xfer(OW, Tx, TxLen * 8, Rx, RxLen * 8) != HAL_OK) return 0;
+		return (OneWire_CRC8(Rx, RxLen) == 0) ? 1 : 0;
+	}
+
+	if (TxLen) ops->WriteBits(OW, Tx, TxLen * 8);
+	for (uint8_t i = 0; i < RxLen; i++)
+	{
+		ops->ReadBits(OW, &Rx[i], 8);
+		if (Check != NULL && !Check(i, Rx[i])) return 0;
+		crc = OneWire_CRC8_Update(crc, Rx[i]);
+	}
+	return (crc == 0) ? 1 : 0;
+}
@@ -5,7 +5,11 @@
   ******************************************************************************
   * @attention
   * Usage:
-  *		Uncomment LL Driver for HAL driver
+  *		Each bus picks its driver at runtime through OneWire_t.Ops, a bus
+  *		left without Ops gets the HAL driver, or the LL driver when LL Driver
+  *		is uncommented. Other drivers are set up by their init function:
+  *			OneWire_IT_Init		timer interrupt bit engine, onewire_it.h
+  *			OneWire_UART_Init	half-duplex UART with DMA, onewire_uart.h
   *
   ******************************************************************************
   */
@@ -23,6 +27,26 @@
 /* Driver Selection ----------------------------------------------------------*/
 //#define LL_Driver
 
+#if defined(LL_Driver) || defined(USE_FULL_LL_DRIVER)
+#define ONEWIRE_LL_ENABLED
+#endif
+
+/* CRC8 with two 16 byte tables instead of one 256 byte table */
+//#define ONEWIRE_CRC_NIBBLE
+
+/* Bus operation profiler, see onewire_prof.h */
+//#define ONEWIRE_PROFILE
+
+/* Slot Timing ---------------------------------------------------------------*/
+/* Budgets in microsecond, interrupts are masked only from the falling edge
+ * to the release of a write 1 and to the sample of a read. Edges of a slot
+ * are deadlines from its falling edge, see DwtWaitUntil */
+#define ONEWIRE_W1_LOW_MAX				15		/* Write 1 low time */
+#define ONEWIRE_W0_LOW_MAX				120		/* Write 0 low time */
+#define ONEWIRE_SAMPLE_MAX				15		/* Read sample after the edge */
+#define ONEWIRE_PRESENCE_MAX			75		/* Reset sample after release */
+#define ONEWIRE_RESET_RETRY				3		/* Resets with a late sample */
+
 /* Common Register -----------------------------------------------------------*/
 #define ONEWIRE_CMD_SEARCHROM			0xF0
 #define ONEWIRE_CMD_READROM				0x33
@@ -36,27 +60,175 @@ typedef enum
 	Output
 } PinMode;
 
+typedef struct __OneWire_t OneWire_t;
+
+/* Bus driver operations */
 typedef struct
+{
+	/* Pin access of the bit-bang slots, NULL when the pin is not a GPIO */
+	void			(*SetMode)(OneWire_t* OW, PinMode Mode);
+	void			(*SetLevel)(OneWire_t* OW, uint8_t Level);
+	uint8_t			(*GetLevel)(OneWire_t* OW);
+
+	/* Slots, bits are LSB first. Reset returns line level, 0 = presence */
+	uint8_t			(*Reset)(OneWire_t* OW);
+	void			(*WriteBits)(OneWire_t* OW, const uint8_t *Data,
+						uint16_t Bits);
+	void			(*ReadBits)(OneWire_t* OW, uint8_t *Data, uint16_t Bits);
+
+	/* Optional, write then read in one bulk transfer. An error fails the
+	 * transaction, it is never replayed through the bit slots */
+	HAL_StatusTypeDef (*Xfer)(OneWire_t* OW, const uint8_t *Tx,
+						uint16_t TxBits, uint8_t *Rx, uint16_t RxBits);
+} OneWire_Ops_t;
+
+/* Slot timing accounting of a bus */
+typedef struct
+{
+	uint32_t		MaskMax;			/* Longest masked window, DWT cycles */
+	uint32_t		Overruns;			/* Slots over their budget */
+} OneWire_Timing_t;
+
+/* Byte check of OneWire_XferCRC, return 0 to abort the transfer */
+typedef uint8_t (*OneWire_Check_t)(uint8_t Idx, uint8_t Byte);
+
+struct __OneWire_t
 {
 	uint8_t 		LastDiscrepancy;
 	uint8_t 		LastFamilyDiscrepancy;
 	uint8_t 		LastDeviceFlag;
 	uint8_t			RomByte[8];
-	uint8_t 		RomCnt;
+	uint16_t		Resets;				/* Reset count, one per transaction */
 	uint16_t		DataPin;
 	GPIO_TypeDef	*DataPort;
-} OneWire_t;
+	uint32_t		ModerMask;			/* MODER bits of DataPin */
+	uint32_t		ModerOut;			/* MODER value of DataPin output */
+	uint32_t		BsrrLow;			/* BSRR value pulling DataPin low */
+	const OneWire_Ops_t *Ops;			/* Bus driver */
+	void			*Ctx;				/* Bus driver state */
+	void			*Mutex;				/* OS mutex, see onewire_os.h */
+	OneWire_Timing_t Timing;			/* Slot timing, since OneWire_Init */
+#ifdef ONEWIRE_PROFILE
+	struct __OneWire_Prof_t *Prof;		/* Profiler, NULL = off */
+#endif
+};
+
+/* Bus Drivers ---------------------------------------------------------------*/
+extern const OneWire_Ops_t OneWire_HAL_Ops;
+extern const OneWire_Ops_t OneWire_OD_Ops;
+#ifdef ONEWIRE_LL_ENABLED
+extern const OneWire_Ops_t OneWire_LL_Ops;
+#endif
 
 /* External Function ---------------------------------------------------------*/
 void OneWire_Init(OneWire_t* OW);
+void OneWire_OD_Init(OneWire_t* OW);
 uint8_t OneWire_Search(OneWire_t* OW, uint8_t Cmd);
+void OneWire_ResetSearch(OneWire_t* OW);
+void OneWire_TargetSetup(OneWire_t* OW, uint8_t Family);
+void OneWire_FamilySkipSetup(OneWire_t* OW);
+uint8_t OneWire_Verify(OneWire_t* OW, const uint8_t *ROM);
 void OneWire_GetDevRom(OneWire_t* OW, uint8_t *dev);
 uint8_t OneWire_Reset(OneWire_t* OW);
+void OneWire_StrongPullup(OneWire_t* OW, uint8_t On);
+void OneWire_StrongPullupCallback(OneWire_t* OW, uint8_t On);
 uint8_t OneWire_ReadBit(OneWire_t* OW);
 uint8_t OneWire_ReadByte(OneWire_t* OW);
 void OneWire_WriteByte(OneWire_t* OW, uint8_t byte);
+void OneWire_ReadBytes(OneWire_t* OW, uint8_t *Data, uint16_t Len);
+void OneWire_WriteBytes(OneWire_t* OW, const uint8_t *Data, uint16_t Len);
+HAL_StatusTypeDef OneWire_Xfer(OneWire_t* OW, const uint8_t *Tx,
+		uint16_t TxLen, uint8_t *Rx, uint16_t RxLen);
 void OneWire_SelectWithPointer(OneWire_t* OW, uint8_t *Rom);
+uint8_t OneWire_XferCRC(OneWire_t* OW, const uint8_t *Tx, uint16_t TxLen,
+		uint8_t *Rx, uint8_t RxLen, OneWire_Check_t Check);
 uint8_t OneWire_CRC8(uint8_t *addr, uint8_t len);
+uint8_t OneWire_BB_Reset(OneWire_t* OW);
+void OneWire_BB_WriteBits(OneWire_t* OW, const uint8_t *Data, uint16_t Bits);
+void OneWire_BB_ReadBits(OneWire_t* OW, uint8_t *Data, uint16_t Bits);
+
+/* CRC8 ---------------------------------------------------------------------*/
+#ifdef ONEWIRE_CRC_NIBBLE
+extern const uint8_t OneWire_CRC8_Lo[16];
+extern const uint8_t OneWire_CRC8_Hi[16];
+#else
+extern const uint8_t OneWire_CRC8_Table[256];
+#endif
+
+/**
+  * @brief  The function is used to add one byte to a running CRC8, a block
+  * 		followed by its CRC byte ends with 0
+  * @retval New CRC value
+  * @param  Crc		CRC so far, 0 at start
+  * @param  Byte	Next byte
+  */
+static inline uint8_t OneWire_CRC8_Update(uint8_t Crc, uint8_t Byte)
+{
+#ifdef ONEWIRE_CRC_NIBBLE
+	Crc ^= Byte;
+	return OneWire_CRC8_Lo[Crc & 0x0F] ^ OneWire_CRC8_Hi[Crc >> 4];
+#else
+	return OneWire_CRC8_Table[Crc ^ Byte];
+#endif
+}
+
+/**
+  * @brief  The function is used to mask interrupts for the critical window
+  * 		of a slot, nests in a window masked by the caller
+  * @retval PRIMASK before
+  * @param  Begin	DWT_CYCCNT at the start of the window
+  */
+static inline uint32_t OneWire_SlotMask(uint32_t *Begin)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*Begin = DWT_CYCCNT;
+	return primask;
+}
+
+/**
+  * @brief  The function is used to end the critical window of a slot and
+  * 		account its length
+  * @retval Window length in DWT cycles
+  * @param  T		Slot timing of the bus
+  * @param  Primask	Returned by OneWire_SlotMask
+  * @param  Begin	DWT_CYCCNT at the start of the window
+  */
+static inline uint32_t OneWire_SlotUnmask(OneWire_Timing_t *T,
+		uint32_t Primask, uint32_t Begin)
+{
+	uint32_t cycles = DWT_CYCCNT - Begin;
+
+	if (!Primask) __enable_irq();
+	if (cycles > T->MaskMax) T->MaskMax = cycles;
+	return cycles;
+}
+
+/**
+  * @brief  The function is used to count a slot over its budget
+  * @retval Overrun = 1, In time = 0
+  * @param  T		Slot timing of the bus
+  * @param  Cycles	Measured time in DWT cycles
+  * @param  Us		Budget in microsecond
+  */
+static inline uint8_t OneWire_SlotCheck(OneWire_Timing_t *T, uint32_t Cycles,
+		uint32_t Us)
+{
+	if (Cycles <= DWT_CYCLES(Us)) return 0;
+
+	T->Overruns++;
+	return 1;
+}
+
+#include "onewire_os.h"
+#include "onewire_prof.h"
+#ifdef HAL_TIM_MODULE_ENABLED
+#include "onewire_it.h"
+#endif
+#ifdef HAL_UART_MODULE_ENABLED
+#include "onewire_uart.h"
+#endif
 
 #ifdef __cplusplus
 }
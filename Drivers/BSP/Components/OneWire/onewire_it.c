@@ -0,0 +1,372 @@
+/**
+  ******************************************************************************
+  * @file    onewire_it.c
+  * @brief   This file includes the interrupt driven bit engine for OneWire
+  * 		 devices. Every slot edge is scheduled on a timer compare, so the
+  * 		 core is free between edges
+  ******************************************************************************
+  */
+#include "onewire.h"
+
+#ifdef HAL_TIM_MODULE_ENABLED
+
+/**
+  * @brief  The internal function is used to pull the line low
+  * @param  OW		OneWire HandleTypedef
+  */
+static inline void OneWire_IT_Low(OneWire_t* OW)
+{
+	OW->DataPort->BSRR = (uint32_t)OW->DataPin << 16;
+	OW->DataPort->MODER = (OW->DataPort->MODER & ~OW->ModerMask) |
+			OW->ModerOut;
+}
+
+/**
+  * @brief  The internal function is used to release the line
+  * @param  OW		OneWire HandleTypedef
+  */
+static inline void OneWire_IT_Release(OneWire_t* OW)
+{
+	OW->DataPort->MODER &= ~OW->ModerMask;
+}
+
+/**
+  * @brief  The internal function is used to schedule the next edge relative
+  * 		to the previous one, so interrupt latency does not add up
+  * @param  IT		Bit engine state
+  * @param  us		Time from previous edge in microsecond
+  */
+static inline void OneWire_IT_Schedule(OneWire_IT_t* IT, uint16_t us)
+{
+	IT->TimNext += us;
+	__HAL_TIM_SET_COMPARE(IT->Tim, IT->TimChannel, IT->TimNext);
+}
+
+/**
+  * @brief  The internal function is used to start the next slot of the
+  * 		transfer or complete it
+  * @param  OW		OneWire HandleTypedef
+  */
+static void OneWire_IT_Next(OneWire_t* OW)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+	uint8_t bit;
+
+	IT->Phase = 0;
+
+	/* Write slots first */
+	if (IT->ItState != OneWire_IT_Read && IT->BitIdx < IT->TxBits)
+	{
+		IT->ItState = OneWire_IT_Write;
+		bit = (IT->TxBuf[IT->BitIdx >> 3] >> (IT->BitIdx & 7)) & 0x01;
+		OneWire_IT_Low(OW);
+		OneWire_IT_Schedule(IT, bit ? ONEWIRE_IT_WRITE1_LOW :
+				ONEWIRE_IT_WRITE0_LOW);
+		return;
+	}
+
+	/* Then read slots */
+	if (IT->ItState != OneWire_IT_Read)
+	{
+		IT->ItState = OneWire_IT_Read;
+		IT->BitIdx = 0;
+	}
+	if (IT->BitIdx < IT->RxBits)
+	{
+		OneWire_IT_Low(OW);
+		OneWire_IT_Schedule(IT, ONEWIRE_IT_READ_LOW);
+		return;
+	}
+
+	/* Transfer complete */
+	HAL_TIM_OC_Stop_IT(IT->Tim, IT->TimChannel);
+	IT->ItState = OneWire_IT_Idle;
+	OneWire_IT_CpltCallback(OW);
+}
+
+/**
+  * @brief  The function is used to initialize the bit engine and select it
+  * 		as bus driver
+  * @param  OW		OneWire HandleTypedef
+  * @param  IT		Bit engine state, one per bus
+  * @param  htim	Timer counting at 1 MHz with period 0xFFFF
+  * @param  Channel	Output compare channel, TIM_CHANNEL_1 - 4
+  */
+void OneWire_IT_Init(OneWire_t* OW, OneWire_IT_t *IT, TIM_HandleTypeDef *htim,
+		uint32_t Channel)
+{
+	IT->Tim = htim;
+	IT->TimChannel = Channel;
+	IT->ItState = OneWire_IT_Idle;
+
+	OW->Ops = &OneWire_IT_Ops;
+	OW->Ctx = IT;
+
+	/* Compare interrupts are enabled per transfer. HAL_TIM_OC_Stop_IT at
+	 * the end of a transfer also stops the counter unless another channel
+	 * is enabled, HAL_TIM_OC_Start_IT of the next transfer restarts it */
+	HAL_TIM_Base_Start(htim);
+}
+
+/**
+  * @brief  The function is used to start a transfer in the background
+  * @retval HAL_OK if started, HAL_BUSY if a transfer is running
+  * @param  OW		OneWire HandleTypedef
+  * @param  Reset	Send reset pulse first, presence is kept in IT->Presence
+  * @param  Tx		Bits to write, LSB first
+  * @param  TxBits	Number of bits to write
+  * @param  Rx		Buffer for bits read, LSB first
+  * @param  RxBits	Number of bits to read after writing
+  */
+HAL_StatusTypeDef OneWire_IT_Xfer(OneWire_t* OW, uint8_t Reset,
+		const uint8_t *Tx, uint16_t TxBits, uint8_t *Rx, uint16_t RxBits)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+
+	if (IT->ItState != OneWire_IT_Idle) return HAL_BUSY;
+
+	IT->TxBuf = Tx;
+	IT->TxBits = TxBits;
+	IT->RxBuf = Rx;
+	IT->RxBits = RxBits;
+	IT->BitIdx = 0;
+	IT->Phase = 0;
+	for (uint16_t i = 0; i < (RxBits + 7) / 8; i++)
+	{
+		Rx[i] = 0;
+	}
+
+	/* First edge is done here, the rest from the timer */
+	IT->TimNext = (uint16_t)__HAL_TIM_GET_COUNTER(IT->Tim);
+	if (Reset)
+	{
+		IT->Presence = 0;
+		IT->ItState = OneWire_IT_Reset;
+		OneWire_IT_Low(OW);
+		OneWire_IT_Schedule(IT, ONEWIRE_IT_RESET_LOW);
+	} else {
+		IT->ItState = OneWire_IT_Write;
+		OneWire_IT_Next(OW);
+	}
+
+	if (IT->ItState != OneWire_IT_Idle)
+	{
+		HAL_TIM_OC_Start_IT(IT->Tim, IT->TimChannel);
+	}
+	return HAL_OK;
+}
+
+/**
+  * @brief  The function is used to check for a running transfer
+  * @retval Busy = 1, Idle = 0
+  * @param  OW		OneWire HandleTypedef
+  */
+uint8_t OneWire_IT_IsBusy(OneWire_t* OW)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+
+	return (IT->ItState != OneWire_IT_Idle) ? 1 : 0;
+}
+
+/**
+  * @brief  The function is used to sleep until the running transfer is done
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_IT_Wait(OneWire_t* OW)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+
+	/* WFI with interrupts masked still wakes up on a pending interrupt, so
+	 * completion between the check and the sleep is not lost. Other tasks
+	 * get the core between the wake-ups */
+	__disable_irq();
+	while (IT->ItState != OneWire_IT_Idle)
+	{
+		ONEWIRE_PROF_WFI(OW);
+		__enable_irq();
+		OneWire_OS_Yield();
+		__disable_irq();
+	}
+	__enable_irq();
+}
+
+/**
+  * @brief  The function is used to handle the timer compare interrupt
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_IT_IRQHandler(OneWire_t* OW)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+	uint8_t bit;
+
+	switch (IT->ItState)
+	{
+		case OneWire_IT_Reset:
+			if (IT->Phase == 0)
+			{
+				/* Release line and wait for presence pulse */
+				OneWire_IT_Release(OW);
+				OneWire_IT_Schedule(IT, ONEWIRE_IT_RESET_SAMPLE);
+				IT->Phase = 1;
+			} else if (IT->Phase == 1) {
+				IT->Presence = (OW->DataPort->IDR & OW->DataPin) ? 0 : 1;
+				OneWire_IT_Schedule(IT, ONEWIRE_IT_RESET_END);
+				IT->Phase = 2;
+			} else {
+				OneWire_IT_Next(OW);
+			}
+			break;
+
+		case OneWire_IT_Write:
+			if (IT->Phase == 0)
+			{
+				/* Release line, 1 is released early */
+				bit = (IT->TxBuf[IT->BitIdx >> 3] >> (IT->BitIdx & 7)) & 0x01;
+				OneWire_IT_Release(OW);
+				OneWire_IT_Schedule(IT, bit ? ONEWIRE_IT_WRITE1_END :
+						ONEWIRE_IT_WRITE0_END);
+				IT->Phase = 1;
+			} else {
+				IT->BitIdx++;
+				OneWire_IT_Next(OW);
+			}
+			break;
+
+		case OneWire_IT_Read:
+			if (IT->Phase == 0)
+			{
+				OneWire_IT_Release(OW);
+				OneWire_IT_Schedule(IT, ONEWIRE_IT_READ_SAMPLE);
+				IT->Phase = 1;
+			} else if (IT->Phase == 1) {
+				if (OW->DataPort->IDR & OW->DataPin)
+				{
+					IT->RxBuf[IT->BitIdx >> 3] |= 1 << (IT->BitIdx & 7);
+				}
+				OneWire_IT_Schedule(IT, ONEWIRE_IT_READ_END);
+				IT->Phase = 2;
+			} else {
+				IT->BitIdx++;
+				OneWire_IT_Next(OW);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  The internal function is used as gpio pin mode
+  * @param  OW		OneWire HandleTypedef
+  * @param  Mode	Input or Output
+  */
+static void OneWire_IT_SetMode(OneWire_t* OW, PinMode Mode)
+{
+	OW->DataPort->MODER = (OW->DataPort->MODER & ~OW->ModerMask) |
+			((Mode == Output) ? OW->ModerOut : 0);
+}
+
+/**
+  * @brief  The internal function is used as gpio pin level
+  * @param  OW		OneWire HandleTypedef
+  * @param  Level	Level: Set/High = 1, Reset/Low = 0
+  */
+static void OneWire_IT_SetLevel(OneWire_t* OW, uint8_t Level)
+{
+	OW->DataPort->BSRR = Level ? OW->DataPin : (uint32_t)OW->DataPin << 16;
+}
+
+/**
+  * @brief  The internal function is used to read data pin
+  * @retval Pin level status
+  * @param  OW		OneWire HandleTypedef
+  */
+static uint8_t OneWire_IT_GetLevel(OneWire_t* OW)
+{
+	return (OW->DataPort->IDR & OW->DataPin) ? 1 : 0;
+}
+
+/**
+  * @brief  The internal function is used to reset device and sleep until
+  * 		done, after the running transfer if any
+  * @retval Line level at sample time, 0 = presence
+  * @param  OW		OneWire HandleTypedef
+  */
+static uint8_t OneWire_IT_ResetWait(OneWire_t* OW)
+{
+	OneWire_IT_t *IT = OW->Ctx;
+
+	/* A background OneWire_IT_Xfer may still run, its presence is not ours */
+	OneWire_IT_Wait(OW);
+	OneWire_IT_Xfer(OW, 1, NULL, 0, NULL, 0);
+	OneWire_IT_Wait(OW);
+
+	return IT->Presence ? 0 : 1;
+}
+
+/**
+  * @brief  The internal function is used to write then read bits and sleep
+  * 		until done
+  * @retval HAL_OK
+  * @param  OW		OneWire HandleTypedef
+  * @param  Tx		Bits to write, LSB first
+  * @param  TxBits	Number of bits to write
+  * @param  Rx		Buffer for bits read, LSB first
+  * @param  RxBits	Number of bits to read after writing
+  */
+static HAL_StatusTypeDef OneWire_IT_XferWait(OneWire_t* OW, const uint8_t *Tx,
+		uint16_t TxBits, uint8_t *Rx, uint16_t RxBits)
+{
+	OneWire_IT_Wait(OW);
+	OneWire_IT_Xfer(OW, 0, Tx, TxBits, Rx, RxBits);
+	OneWire_IT_Wait(OW);
+
+	return HAL_OK;
+}
+
+/**
+  * @brief  The internal function is used to write bits
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Bits to write, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_IT_WriteBits(OneWire_t* OW, const uint8_t *Data,
+		uint16_t Bits)
+{
+	OneWire_IT_XferWait(OW, Data, Bits, NULL, 0);
+}
+
+/**
+  * @brief  The internal function is used to read bits
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Buffer for bits read, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_IT_ReadBits(OneWire_t* OW, uint8_t *Data, uint16_t Bits)
+{
+	OneWire_IT_XferWait(OW, NULL, 0, Data, Bits);
+}
+
+const OneWire_Ops_t OneWire_IT_Ops =
+{
+	.SetMode	= OneWire_IT_SetMode,
+	.SetLevel	= OneWire_IT_SetLevel,
+	.GetLevel	= OneWire_IT_GetLevel,
+	.Reset		= OneWire_IT_ResetWait,
+	.WriteBits	= OneWire_IT_WriteBits,
+	.ReadBits	= OneWire_IT_ReadBits,
+	.Xfer		= OneWire_IT_XferWait
+};
+
+/**
+  * @brief  The function is called from the interrupt when a transfer is done
+  * @param  OW		OneWire HandleTypedef
+  */
+__weak void OneWire_IT_CpltCallback(OneWire_t* OW)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)OW;
+}
+
+#endif /* HAL_TIM_MODULE_ENABLED */
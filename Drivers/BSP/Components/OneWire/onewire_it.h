@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    onewire_it.h
+  * @brief   This file contains all the constants parameters for the interrupt
+  * 		 driven OneWire bit engine
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Set up a timer counting at 1 MHz with period 0xFFFF and one output
+  *		compare channel without output, then call OneWire_IT_Init after the
+  *		pin is set and before OneWire_Init. Forward the compare interrupt to
+  *		the engine:
+  *
+  *		void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+  *		{
+  *			if (htim == OW_IT.Tim) OneWire_IT_IRQHandler(&OW);
+  *		}
+  *
+  *		OneWire_IT_Xfer runs reset, write and read slots in the background,
+  *		OneWire_IT_CpltCallback is called from the interrupt when done.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_IT_H
+#define ONEWIRE_IT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "onewire.h"
+
+/* Slot Timing (us) ----------------------------------------------------------*/
+#define ONEWIRE_IT_RESET_LOW			480
+#define ONEWIRE_IT_RESET_SAMPLE			70
+#define ONEWIRE_IT_RESET_END			410
+#define ONEWIRE_IT_WRITE1_LOW			10
+#define ONEWIRE_IT_WRITE1_END			55
+#define ONEWIRE_IT_WRITE0_LOW			65
+#define ONEWIRE_IT_WRITE0_END			5
+#define ONEWIRE_IT_READ_LOW				3
+#define ONEWIRE_IT_READ_SAMPLE			10
+#define ONEWIRE_IT_READ_END				50
+
+/* Data Structure ------------------------------------------------------------*/
+typedef enum
+{
+	OneWire_IT_Idle,
+	OneWire_IT_Reset,
+	OneWire_IT_Write,
+	OneWire_IT_Read
+} OneWire_IT_State_t;
+
+typedef struct
+{
+	TIM_HandleTypeDef *Tim;				/* 1 MHz timer, period 0xFFFF */
+	uint32_t		TimChannel;			/* Output compare channel */
+	uint16_t		TimNext;			/* Compare value of next edge */
+	const uint8_t	*TxBuf;
+	uint8_t			*RxBuf;
+	uint16_t		TxBits;
+	uint16_t		RxBits;
+	uint16_t		BitIdx;
+	uint8_t			Phase;
+	uint8_t			Presence;
+	volatile uint8_t ItState;
+} OneWire_IT_t;
+
+/* Bus Driver ----------------------------------------------------------------*/
+extern const OneWire_Ops_t OneWire_IT_Ops;
+
+/* External Function ---------------------------------------------------------*/
+void OneWire_IT_Init(OneWire_t* OW, OneWire_IT_t *IT, TIM_HandleTypeDef *htim,
+		uint32_t Channel);
+HAL_StatusTypeDef OneWire_IT_Xfer(OneWire_t* OW, uint8_t Reset,
+		const uint8_t *Tx, uint16_t TxBits, uint8_t *Rx, uint16_t RxBits);
+uint8_t OneWire_IT_IsBusy(OneWire_t* OW);
+void OneWire_IT_Wait(OneWire_t* OW);
+void OneWire_IT_IRQHandler(OneWire_t* OW);
+void OneWire_IT_CpltCallback(OneWire_t* OW);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_IT_H */
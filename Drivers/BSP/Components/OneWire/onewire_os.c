@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    onewire_os.c
+  * @brief   This file includes the bare-metal defaults of the OneWire OS
+  * 		 abstraction, overridden by an RTOS port
+  ******************************************************************************
+  */
+#include "onewire.h"
+#include "dwt.h"
+
+/**
+  * @brief  The function is used to create the mutex of a bus, once
+  * @param  OW		OneWire HandleTypedef
+  */
+__weak void OneWire_OS_Init(OneWire_t* OW)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)OW;
+}
+
+/**
+  * @brief  The function is used to take the bus for a transaction, nested
+  * 		calls from the same task must not block
+  * @param  OW		OneWire HandleTypedef
+  */
+__weak void OneWire_OS_Lock(OneWire_t* OW)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)OW;
+}
+
+/**
+  * @brief  The function is used to give the bus back
+  * @param  OW		OneWire HandleTypedef
+  */
+__weak void OneWire_OS_Unlock(OneWire_t* OW)
+{
+	/* Prevent unused argument(s) compilation warning */
+	(void)OW;
+}
+
+/**
+  * @brief  The function is used to wait in millisecond
+  * @param  Ms		Period in millisecond
+  */
+__weak void OneWire_OS_Delay(uint32_t Ms)
+{
+	HAL_Delay(Ms);
+}
+
+/**
+  * @brief  The function is used to wait in microsecond where running late
+  * 		does no harm
+  * @param  Us		Period in microsecond, at least
+  */
+__weak void OneWire_OS_Delay_us(uint32_t Us)
+{
+	DwtDelay_us(Us);
+}
+
+/**
+  * @brief  The function is used to give the core away once while polling
+  */
+__weak void OneWire_OS_Yield(void)
+{
+}
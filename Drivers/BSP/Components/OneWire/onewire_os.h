@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    onewire_os.h
+  * @brief   This file contains the OS abstraction of the OneWire driver, bus
+  * 		 locking and waits that may give the core to other tasks
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		The functions are weak, the bare-metal defaults spin and do not
+  *		lock. An RTOS port defines all of them in its own file:
+  *
+  *			OneWire_OS_Init		create the mutex of a bus in OW->Mutex
+  *			OneWire_OS_Lock		take the bus mutex, recursive
+  *			OneWire_OS_Unlock	give the bus mutex
+  *			OneWire_OS_Delay	sleep in millisecond
+  *			OneWire_OS_Delay_us	wait that may run late, e.g. reset low
+  *			OneWire_OS_Yield	give the core once, in polling loops
+  *
+  *		Host/Src/onewire_os_posix.c is the POSIX port of the host build.
+  *		Slot edges and sample points never go through these waits.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_OS_H
+#define ONEWIRE_OS_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "onewire.h"
+
+/* External Function ---------------------------------------------------------*/
+void OneWire_OS_Init(OneWire_t* OW);
+void OneWire_OS_Lock(OneWire_t* OW);
+void OneWire_OS_Unlock(OneWire_t* OW);
+void OneWire_OS_Delay(uint32_t Ms);
+void OneWire_OS_Delay_us(uint32_t Us);
+void OneWire_OS_Yield(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_OS_H */
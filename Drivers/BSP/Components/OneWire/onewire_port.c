@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    onewire_port.c
+  * @brief   This file includes the port parallel driver for OneWire devices,
+  * 		 the lines of one GPIO port are bit-banged together
+  ******************************************************************************
+  */
+#include "onewire_port.h"
+
+/**
+  * @brief  The internal function is used to get the MODER bits of lines
+  * @retval MODER mask, 2 bits per line
+  * @param  Mask	Lines
+  */
+static uint32_t OneWire_Port_Moder(uint16_t Mask)
+{
+	uint32_t moder = 0;
+
+	for (uint8_t i = 0; i < ONEWIRE_PORT_LINES; i++)
+	{
+		if (Mask & (1U << i)) moder |= 3U << (i * 2);
+	}
+	return moder;
+}
+
+/**
+  * @brief  The internal function is used to pull lines low
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  * @param  Moder	MODER mask of lines
+  */
+static inline void OneWire_Port_Low(OneWire_Port_t *P, uint16_t Mask,
+		uint32_t Moder)
+{
+	P->Port->BSRR = (uint32_t)Mask << 16;
+	P->Port->MODER = (P->Port->MODER & ~Moder) | (Moder & 0x55555555U);
+}
+
+/**
+  * @brief  The internal function is used to release lines
+  * @param  P		OneWire port HandleTypedef
+  * @param  Moder	MODER mask of lines
+  */
+static inline void OneWire_Port_Release(OneWire_Port_t *P, uint32_t Moder)
+{
+	P->Port->MODER &= ~Moder;
+}
+
+/**
+  * @brief  The function is used to initialize the lines, all are released
+  * @param  P		OneWire port HandleTypedef
+  * @param  Port	GPIO port of the buses
+  * @param  Pins	Lines of the buses
+  */
+void OneWire_Port_Init(OneWire_Port_t *P, GPIO_TypeDef *Port, uint16_t Pins)
+{
+	P->Port = Port;
+	P->Pins = Pins;
+	P->Timing.MaskMax = 0;
+	P->Timing.Overruns = 0;
+
+	OneWire_Port_Release(P, OneWire_Port_Moder(Pins));
+	DwtDelay_us(1000);
+}
+
+/**
+  * @brief  The function is used to reset devices on all lines in mask
+  * @retval Lines with presence pulse
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  */
+uint16_t OneWire_Port_Reset(OneWire_Port_t *P, uint16_t Mask)
+{
+	uint32_t moder, primask, begin, end;
+	uint16_t idr;
+	uint8_t late, retry = ONEWIRE_RESET_RETRY;
+
+	Mask &= P->Pins;
+	moder = OneWire_Port_Moder(Mask);
+
+	do
+	{
+		/* Line low, and wait 480us */
+		OneWire_Port_Low(P, Mask, moder);
+		OneWire_OS_Delay_us(480);
+
+		/* Release line and wait for 70us */
+		primask = OneWire_SlotMask(&begin);
+		OneWire_Port_Release(P, moder);
+		OneWire_SlotUnmask(&P->Timing, primask, begin);
+		DwtWaitUntil(DwtDeadline_us(begin, 70));
+
+		/* Sample all lines */
+		primask = OneWire_SlotMask(&end);
+		idr = (uint16_t)P->Port->IDR;
+		OneWire_SlotUnmask(&P->Timing, primask, end);
+		late = OneWire_SlotCheck(&P->Timing, end - begin,
+				ONEWIRE_PRESENCE_MAX);
+
+		/* Delay for 410 us, the lines are idle */
+		OneWire_OS_Delay_us(410);
+
+		/* Lines high after the presence pulse could have ended, again */
+	} while (late && (Mask & idr) && --retry);
+
+	return Mask & ~idr;
+}
+
+/**
+  * @brief  The internal function is used to write one bit on every line
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  * @param  Moder	MODER mask of lines
+  * @param  Ones	MODER mask of lines writing 1
+  */
+static void OneWire_Port_WriteSlot(OneWire_Port_t *P, uint16_t Mask,
+		uint32_t Moder, uint32_t Ones)
+{
+	uint32_t primask, begin, end;
+
+	/* Set lines low, masked until the lines writing 1 are released */
+	primask = OneWire_SlotMask(&begin);
+	OneWire_Port_Low(P, Mask, Moder);
+	DwtWaitUntil(DwtDeadline_us(begin, 10));
+
+	/* Lines writing 1 high */
+	OneWire_Port_Release(P, Ones);
+	OneWire_SlotCheck(&P->Timing, OneWire_SlotUnmask(&P->Timing, primask,
+			begin), ONEWIRE_W1_LOW_MAX);
+	DwtWaitUntil(DwtDeadline_us(begin, 65));
+
+	/* Lines writing 0 high */
+	primask = OneWire_SlotMask(&end);
+	OneWire_Port_Release(P, Moder);
+	OneWire_SlotUnmask(&P->Timing, primask, end);
+	OneWire_SlotCheck(&P->Timing, end - begin, ONEWIRE_W0_LOW_MAX);
+	DwtWaitUntil(DwtDeadline_us(begin, 70));
+}
+
+/**
+  * @brief  The internal function is used to read one bit on every line
+  * @retval Lines reading 1
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  * @param  Moder	MODER mask of lines
+  */
+static uint16_t OneWire_Port_ReadSlot(OneWire_Port_t *P, uint16_t Mask,
+		uint32_t Moder)
+{
+	uint32_t primask, begin;
+	uint16_t idr;
+
+	/* Lines low, masked until the sample */
+	primask = OneWire_SlotMask(&begin);
+	OneWire_Port_Low(P, Mask, Moder);
+	DwtWaitUntil(DwtDeadline_us(begin, 3));
+
+	/* Release lines, sample at 13 us */
+	OneWire_Port_Release(P, Moder);
+	DwtWaitUntil(DwtDeadline_us(begin, 13));
+
+	/* Read all lines */
+	idr = (uint16_t)P->Port->IDR;
+	OneWire_SlotCheck(&P->Timing, OneWire_SlotUnmask(&P->Timing, primask,
+			begin), ONEWIRE_SAMPLE_MAX);
+
+	/* Complete the 63 us slot */
+	DwtWaitUntil(DwtDeadline_us(begin, 63));
+
+	return idr & Mask;
+}
+
+/**
+  * @brief  The function is used to read one bit on all lines in mask
+  * @retval Lines reading 1
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  */
+uint16_t OneWire_Port_ReadBit(OneWire_Port_t *P, uint16_t Mask)
+{
+	Mask &= P->Pins;
+
+	return OneWire_Port_ReadSlot(P, Mask, OneWire_Port_Moder(Mask));
+}
+
+/**
+  * @brief  The function is used to write the same byte on all lines in mask
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  * @param  Byte	byte to write
+  */
+void OneWire_Port_WriteByte(OneWire_Port_t *P, uint16_t Mask, uint8_t Byte)
+{
+	uint32_t moder;
+
+	Mask &= P->Pins;
+	moder = OneWire_Port_Moder(Mask);
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		OneWire_Port_WriteSlot(P, Mask, moder, (Byte & 0x01) ? moder : 0);
+		Byte >>= 1;
+	}
+}
+
+/**
+  * @brief  The function is used to write bytes and then read bytes on all
+  * 		lines in mask, each line with its own data
+  * @param  P		OneWire port HandleTypedef
+  * @param  Mask	Lines
+  * @param  Tx		Bytes to write, TxLen bytes per pin number
+  * @param  TxLen	Number of bytes to write per line
+  * @param  Rx		Buffer for bytes read, RxLen bytes per pin number
+  * @param  RxLen	Number of bytes to read per line
+  */
+void OneWire_Port_Xfer(OneWire_Port_t *P, uint16_t Mask, const uint8_t *Tx,
+		uint16_t TxLen, uint8_t *Rx, uint16_t RxLen)
+{
+	uint32_t moder;
+	uint16_t ones;
+	uint8_t i, bit;
+
+	Mask &= P->Pins;
+	moder = OneWire_Port_Moder(Mask);
+
+	for (uint16_t n = 0; n < TxLen * 8; n++)
+	{
+		/* Collect the lines writing 1 before the slot starts */
+		ones = 0;
+		for (i = 0; i < ONEWIRE_PORT_LINES; i++)
+		{
+			if ((Mask & (1U << i)) &&
+					((Tx[i * TxLen + (n >> 3)] >> (n & 7)) & 0x01))
+			{
+				ones |= 1U << i;
+			}
+		}
+		OneWire_Port_WriteSlot(P, Mask, moder, OneWire_Port_Moder(ones));
+	}
+
+	for (i = 0; i < ONEWIRE_PORT_LINES; i++)
+	{
+		if (!(Mask & (1U << i))) continue;
+		for (uint16_t n = 0; n < RxLen; n++)
+		{
+			Rx[i * RxLen + n] = 0;
+		}
+	}
+
+	for (uint16_t n = 0; n < RxLen * 8; n++)
+	{
+		ones = OneWire_Port_ReadSlot(P, Mask, moder);
+
+		/* Spread the lines reading 1 to their rows */
+		bit = 1 << (n & 7);
+		for (i = 0; ones; i++, ones >>= 1)
+		{
+			if (ones & 0x01) Rx[i * RxLen + (n >> 3)] |= bit;
+		}
+	}
+}
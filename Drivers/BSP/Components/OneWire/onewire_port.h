@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    onewire_port.h
+  * @brief   This file contains all the constants parameters for the port
+  * 		 parallel OneWire driver
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Up to 16 buses on one GPIO port run their slots together. Every slot
+  *		edge is a single BSRR/MODER write for all lines, and all lines are
+  *		sampled with a single IDR read, so a transfer on 16 buses takes as
+  *		long as on one bus.
+  *
+  *		Per bus data is kept in bulk arrays indexed by pin number (0 - 15),
+  *		a row of Len bytes per pin, e.g. uint8_t Rx[16][9] for scratchpads.
+  *		Lines not in the transfer mask are left untouched.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_PORT_H
+#define ONEWIRE_PORT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "onewire.h"
+
+/* Data Structure ------------------------------------------------------------*/
+#define ONEWIRE_PORT_LINES				16
+
+typedef struct
+{
+	GPIO_TypeDef	*Port;
+	uint16_t		Pins;				/* Lines of the buses */
+	OneWire_Timing_t Timing;			/* Slot timing of all lines */
+} OneWire_Port_t;
+
+/* External Function ---------------------------------------------------------*/
+void OneWire_Port_Init(OneWire_Port_t *P, GPIO_TypeDef *Port, uint16_t Pins);
+uint16_t OneWire_Port_Reset(OneWire_Port_t *P, uint16_t Mask);
+uint16_t OneWire_Port_ReadBit(OneWire_Port_t *P, uint16_t Mask);
+void OneWire_Port_WriteByte(OneWire_Port_t *P, uint16_t Mask, uint8_t Byte);
+void OneWire_Port_Xfer(OneWire_Port_t *P, uint16_t Mask, const uint8_t *Tx,
+		uint16_t TxLen, uint8_t *Rx, uint16_t RxLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_PORT_H */
@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file    onewire_prof.c
+  * @brief   This file includes the bus operation profiler, built with
+  * 		 ONEWIRE_PROFILE only
+  ******************************************************************************
+  */
+#include "onewire_prof.h"
+
+#ifdef ONEWIRE_PROFILE
+#include <stdio.h>
+#include <string.h>
+
+static const char * const OneWire_ProfName[OneWire_Prof_Cnt] =
+{
+	"reset", "bit", "byte", "search", "scratchpad", "config"
+};
+
+/**
+  * @brief  The function is used to attach profiler storage to a bus and
+  * 		clear it
+  * @param  OW		OneWire HandleTypedef
+  * @param  Prof	Profiler storage of the bus
+  */
+void OneWire_Prof_Init(OneWire_t* OW, OneWire_Prof_t *Prof)
+{
+	OW->Prof = Prof;
+	OneWire_Prof_Clear(OW);
+}
+
+/**
+  * @brief  The function is used to clear the statistics of a bus
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_Prof_Clear(OneWire_t* OW)
+{
+	OneWire_Prof_t *P = OW->Prof;
+
+	if (P == NULL) return;
+
+	memset(P, 0, sizeof(*P));
+	for (uint8_t i = 0; i < OneWire_Prof_Cnt; i++)
+	{
+		P->Op[i].Min = 0xFFFFFFFFU;
+	}
+	P->LastDump = HAL_GetTick();
+}
+
+/**
+  * @brief  The function is used to record an operation that started at
+  * 		the mark
+  * @param  OW		OneWire HandleTypedef
+  * @param  M		Start mark
+  * @param  Op		Operation
+  */
+void OneWire_Prof_Record(OneWire_t* OW, const OneWire_ProfMark_t *M,
+		OneWire_ProfOp_t Op)
+{
+	OneWire_Prof_t *P = OW->Prof;
+	OneWire_ProfStat_t *S;
+	uint32_t cycles, us, limit = 16;
+	uint8_t b = 0;
+
+	if (P == NULL) return;
+
+	cycles = DWT_CYCCNT - M->Start;
+	S = &P->Op[Op];
+	S->Calls++;
+	S->Cycles += cycles;
+	S->Cpu += cycles - (P->Sleep - M->Sleep);
+	if (cycles < S->Min) S->Min = cycles;
+	if (cycles > S->Max) S->Max = cycles;
+
+	us = cycles / DwtCycUs;
+	while (b < ONEWIRE_PROF_BUCKETS - 1 && us >= limit)
+	{
+		limit <<= 2;
+		b++;
+	}
+	S->Hist[b]++;
+}
+
+/**
+  * @brief  The function is used to sleep until an interrupt, the time is
+  * 		not counted as cpu time
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_Prof_Wfi(OneWire_t* OW)
+{
+	uint32_t start = DWT_CYCCNT;
+
+	__WFI();
+	if (OW->Prof != NULL) OW->Prof->Sleep += DWT_CYCCNT - start;
+}
+
+/**
+  * @brief  The function is used to print the statistics of a bus, times in
+  * 		microsecond, histogram buckets below 16, 64, 256 ... us
+  * @param  OW		OneWire HandleTypedef
+  * @param  Name	Bus name in the dump
+  */
+void OneWire_Prof_Dump(OneWire_t* OW, const char *Name)
+{
+	OneWire_Prof_t *P = OW->Prof;
+	uint32_t cyc = DwtCycUs;		/* As the histogram */
+
+	if (P == NULL) return;
+
+	printf("onewire %s: op calls bus_us cpu_us min_us max_us | hist\r\n",
+			Name);
+	for (uint8_t i = 0; i < OneWire_Prof_Cnt; i++)
+	{
+		OneWire_ProfStat_t *S = &P->Op[i];
+
+		if (S->Calls == 0) continue;
+
+		printf("  %-10s %8lu %11lu %11lu %8lu %8lu |", OneWire_ProfName[i],
+				(unsigned long)S->Calls, (unsigned long)(S->Cycles / cyc),
+				(unsigned long)(S->Cpu / cyc), (unsigned long)(S->Min / cyc),
+				(unsigned long)(S->Max / cyc));
+		for (uint8_t b = 0; b < ONEWIRE_PROF_BUCKETS; b++)
+		{
+			printf(" %lu", (unsigned long)S->Hist[b]);
+		}
+		printf("\r\n");
+	}
+}
+
+/**
+  * @brief  The function is used to dump the statistics of a bus once per
+  * 		period, call it from the main loop
+  * @retval Dumped = 1, Not yet = 0
+  * @param  OW		OneWire HandleTypedef
+  * @param  Name	Bus name in the dump
+  * @param  Period	Dump period in millisecond
+  */
+uint8_t OneWire_Prof_Process(OneWire_t* OW, const char *Name,
+		uint32_t Period)
+{
+	if (OW->Prof == NULL) return 0;
+	if ((HAL_GetTick() - OW->Prof->LastDump) < Period) return 0;
+
+	OneWire_Prof_Dump(OW, Name);
+	OW->Prof->LastDump = HAL_GetTick();
+	return 1;
+}
+#endif /* ONEWIRE_PROFILE */
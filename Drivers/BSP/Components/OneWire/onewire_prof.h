@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    onewire_prof.h
+  * @brief   This file contains the bus operation profiler, cycle and call
+  * 		 counts per operation from DWT_CYCCNT
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Uncomment ONEWIRE_PROFILE in onewire.h, without it the macros below
+  *		compile to nothing and the functions do not exist. Attach storage
+  *		to each bus to profile, then dump from the main loop:
+  *
+  *			static OneWire_Prof_t Prof;
+  *			OneWire_Prof_Init(&OW, &Prof);
+  *			...
+  *			OneWire_Prof_Process(&OW, "bus0", 10000);
+  *
+  *		The dump goes through printf, __io_putchar sends it over ITM.
+  *		An operation includes the ones it calls, a search its resets and
+  *		bits. Cpu is the time not spent in WFI waiting for the IT or UART
+  *		driver, the same as the bus time for the bit-bang drivers.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_PROF_H
+#define ONEWIRE_PROF_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "onewire.h"
+
+/* Data Structure ------------------------------------------------------------*/
+/* Histogram buckets, bucket n counts times below 16 << (2 * n) us */
+#define ONEWIRE_PROF_BUCKETS			8
+
+typedef enum
+{
+	OneWire_Prof_Reset,
+	OneWire_Prof_Bit,
+	OneWire_Prof_Byte,					/* Byte transfer, one per call */
+	OneWire_Prof_Search,
+	OneWire_Prof_Scratchpad,			/* DS18B20 read scratchpad */
+	OneWire_Prof_Config,				/* DS18B20 config write and copy */
+	OneWire_Prof_Cnt
+} OneWire_ProfOp_t;
+
+typedef struct
+{
+	uint32_t		Calls;
+	uint64_t		Cycles;				/* Bus time */
+	uint64_t		Cpu;				/* Time not slept */
+	uint32_t		Min;
+	uint32_t		Max;
+	uint32_t		Hist[ONEWIRE_PROF_BUCKETS];
+} OneWire_ProfStat_t;
+
+typedef struct __OneWire_Prof_t
+{
+	OneWire_ProfStat_t Op[OneWire_Prof_Cnt];
+	uint32_t		Sleep;				/* Cycles in WFI, running sum */
+	uint32_t		LastDump;			/* HAL tick of the last dump */
+} OneWire_Prof_t;
+
+/* Start of a profiled operation */
+typedef struct
+{
+	uint32_t		Start;
+	uint32_t		Sleep;
+} OneWire_ProfMark_t;
+
+/* Instrumentation -----------------------------------------------------------*/
+#ifdef ONEWIRE_PROFILE
+#define ONEWIRE_PROF_BEGIN(OW, M)		OneWire_ProfMark_t M = \
+											OneWire_Prof_Mark(OW)
+#define ONEWIRE_PROF_END(OW, M, Op)		OneWire_Prof_Record((OW), &(M), (Op))
+#define ONEWIRE_PROF_WFI(OW)			OneWire_Prof_Wfi(OW)
+#else
+#define ONEWIRE_PROF_BEGIN(OW, M)
+#define ONEWIRE_PROF_END(OW, M, Op)
+#define ONEWIRE_PROF_WFI(OW)			__WFI()
+#endif
+
+#ifdef ONEWIRE_PROFILE
+/* External Function ---------------------------------------------------------*/
+void OneWire_Prof_Init(OneWire_t* OW, OneWire_Prof_t *Prof);
+void OneWire_Prof_Clear(OneWire_t* OW);
+void OneWire_Prof_Record(OneWire_t* OW, const OneWire_ProfMark_t *M,
+		OneWire_ProfOp_t Op);
+void OneWire_Prof_Wfi(OneWire_t* OW);
+void OneWire_Prof_Dump(OneWire_t* OW, const char *Name);
+uint8_t OneWire_Prof_Process(OneWire_t* OW, const char *Name,
+		uint32_t Period);
+
+/**
+  * @brief  The function is used to mark the start of an operation
+  * @retval Start mark
+  * @param  OW		OneWire HandleTypedef
+  */
+static inline OneWire_ProfMark_t OneWire_Prof_Mark(OneWire_t* OW)
+{
+	OneWire_ProfMark_t m;
+
+	m.Start = DWT_CYCCNT;
+	m.Sleep = (OW->Prof != NULL) ? OW->Prof->Sleep : 0;
+	return m;
+}
+#endif /* ONEWIRE_PROFILE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_PROF_H */
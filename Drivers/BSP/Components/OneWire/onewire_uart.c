@@ -0,0 +1,253 @@
+/**
+  ******************************************************************************
+  * @file    onewire_uart.c
+  * @brief   This file includes the UART + DMA driver for OneWire devices.
+  * 		 A whole transaction is moved by DMA in one transfer, the core
+  * 		 sleeps until the receive complete interrupt
+  ******************************************************************************
+  */
+#include "onewire.h"
+
+#ifdef HAL_UART_MODULE_ENABLED
+
+/**
+  * @brief  The internal function is used to change the baud rate
+  * @param  U		UART driver state
+  * @param  Baud	Baud rate
+  */
+static void OneWire_UART_SetBaud(OneWire_UART_t* U, uint32_t Baud)
+{
+	if (U->Uart->Init.BaudRate == Baud) return;
+
+	U->Uart->Init.BaudRate = Baud;
+	HAL_HalfDuplex_Init(U->Uart);
+}
+
+/**
+  * @brief  The internal function is used to send the UART buffer and sleep
+  * 		until its echo is received. A UART error, or no echo within twice
+  * 		the frame time, aborts the transfer
+  * @retval HAL_OK, HAL_ERROR on UART / DMA error or timeout
+  * @param  OW		OneWire HandleTypedef
+  * @param  Len		Number of UART byte
+  */
+static HAL_StatusTypeDef OneWire_UART_Run(OneWire_t* OW, uint16_t Len)
+{
+	OneWire_UART_t *U = OW->Ctx;
+	uint32_t deadline;
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+	SCB_CleanDCache_by_Addr((uint32_t *)U->Tx, sizeof(U->Tx));
+#endif
+
+	/* Receiver first, the echo starts with the first start bit */
+	U->Busy = 1;
+	U->Error = 0;
+	if (HAL_UART_Receive_DMA(U->Uart, U->Rx, Len) != HAL_OK ||
+			HAL_UART_Transmit_DMA(U->Uart, U->Tx, Len) != HAL_OK)
+	{
+		U->Error = 1;
+	}
+
+	/* 10 bit per byte, twice the frame time plus margin */
+	deadline = DwtDeadline_us(DwtNow(), (uint32_t)Len * 20000U /
+			(U->Uart->Init.BaudRate / 1000U) + ONEWIRE_UART_MARGIN);
+
+	/* WFI with interrupts masked still wakes up on a pending interrupt,
+	 * the SysTick wakes it up to check the deadline. Other tasks get the
+	 * core between the wake-ups */
+	__disable_irq();
+	while (U->Busy && !U->Error && !DwtExpired(deadline))
+	{
+		ONEWIRE_PROF_WFI(OW);
+		__enable_irq();
+		OneWire_OS_Yield();
+		__disable_irq();
+	}
+	__enable_irq();
+
+	if (U->Busy || U->Error)
+	{
+		/* Stops both DMA, the line is released */
+		HAL_UART_Abort(U->Uart);
+		U->Busy = 0;
+		U->Errors++;
+		return HAL_ERROR;
+	}
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+	SCB_InvalidateDCache_by_Addr((uint32_t *)U->Rx, sizeof(U->Rx));
+#endif
+	return HAL_OK;
+}
+
+/**
+  * @brief  The function is used to initialize the UART driver and select it
+  * 		as bus driver
+  * @param  OW		OneWire HandleTypedef
+  * @param  U		UART driver state with DMA buffers, one per bus
+  * @param  huart	UART in half-duplex mode
+  */
+void OneWire_UART_Init(OneWire_t* OW, OneWire_UART_t *U,
+		UART_HandleTypeDef *huart)
+{
+	U->Uart = huart;
+	U->Busy = 0;
+	U->Error = 0;
+	U->Errors = 0;
+
+	OW->Ops = &OneWire_UART_Ops;
+	OW->Ctx = U;
+
+	/* Force the slot baud rate */
+	huart->Init.BaudRate = 0;
+	OneWire_UART_SetBaud(U, ONEWIRE_UART_BAUD_SLOT);
+}
+
+/**
+  * @brief  The function is used to reset device, the reset pulse is a 0xF0
+  * 		at 9600 baud, a presence pulse corrupts the echo
+  * @retval Line level at sample time, 0 = presence, 1 on a failed transfer
+  * @param  OW		OneWire HandleTypedef
+  */
+uint8_t OneWire_UART_Reset(OneWire_t* OW)
+{
+	OneWire_UART_t *U = OW->Ctx;
+	HAL_StatusTypeDef status;
+
+	OneWire_UART_SetBaud(U, ONEWIRE_UART_BAUD_RESET);
+	U->Tx[0] = ONEWIRE_UART_RESET;
+	status = OneWire_UART_Run(OW, 1);
+	OneWire_UART_SetBaud(U, ONEWIRE_UART_BAUD_SLOT);
+
+	/* A shorted line gives a framing error, not a presence */
+	if (status != HAL_OK) return 1;
+	return (U->Rx[0] == ONEWIRE_UART_RESET) ? 1 : 0;
+}
+
+/**
+  * @brief  The function is used to write and then read bits, read slots are
+  * 		sent as 1. Up to ONEWIRE_UART_MAXBITS slots go in one DMA transfer
+  * @retval HAL_OK, HAL_ERROR on a failed transfer, Rx then reads as 1
+  * @param  OW		OneWire HandleTypedef
+  * @param  Tx		Bits to write, LSB first
+  * @param  TxBits	Number of bits to write
+  * @param  Rx		Buffer for bits read, LSB first
+  * @param  RxBits	Number of bits to read after writing
+  */
+HAL_StatusTypeDef OneWire_UART_Xfer(OneWire_t* OW, const uint8_t *Tx,
+		uint16_t TxBits, uint8_t *Rx, uint16_t RxBits)
+{
+	OneWire_UART_t *U = OW->Ctx;
+	uint16_t i, n, pos = 0, total = TxBits + RxBits;
+
+	for (i = 0; i < (RxBits + 7) / 8; i++)
+	{
+		Rx[i] = 0;
+	}
+
+	while (pos < total)
+	{
+		n = total - pos;
+		if (n > ONEWIRE_UART_MAXBITS) n = ONEWIRE_UART_MAXBITS;
+
+		/* One UART byte per bit */
+		for (i = 0; i < n; i++)
+		{
+			uint16_t b = pos + i;
+
+			if (b < TxBits)
+			{
+				U->Tx[i] = ((Tx[b >> 3] >> (b & 7)) & 0x01) ?
+						ONEWIRE_UART_BIT1 : ONEWIRE_UART_BIT0;
+			} else {
+				U->Tx[i] = ONEWIRE_UART_BIT1;
+			}
+		}
+
+		if (OneWire_UART_Run(OW, n) != HAL_OK)
+		{
+			/* Idle line, the caller falls back or fails the CRC */
+			for (i = 0; i < (RxBits + 7) / 8; i++)
+			{
+				Rx[i] = 0xFF;
+			}
+			return HAL_ERROR;
+		}
+
+		/* A device sending 0 pulls the echo low */
+		for (i = 0; i < n; i++)
+		{
+			uint16_t b = pos + i;
+
+			if (b >= TxBits && U->Rx[i] == ONEWIRE_UART_BIT1)
+			{
+				b -= TxBits;
+				Rx[b >> 3] |= 1 << (b & 7);
+			}
+		}
+		pos += n;
+	}
+	return HAL_OK;
+}
+
+/**
+  * @brief  The internal function is used to write bits
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Bits to write, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_UART_WriteBits(OneWire_t* OW, const uint8_t *Data,
+		uint16_t Bits)
+{
+	OneWire_UART_Xfer(OW, Data, Bits, NULL, 0);
+}
+
+/**
+  * @brief  The internal function is used to read bits
+  * @param  OW		OneWire HandleTypedef
+  * @param  Data	Buffer for bits read, LSB first
+  * @param  Bits	Number of bits
+  */
+static void OneWire_UART_ReadBits(OneWire_t* OW, uint8_t *Data, uint16_t Bits)
+{
+	OneWire_UART_Xfer(OW, NULL, 0, Data, Bits);
+}
+
+/**
+  * @brief  The function is called from the UART receive complete interrupt
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_UART_RxCpltCallback(OneWire_t* OW)
+{
+	OneWire_UART_t *U = OW->Ctx;
+
+	U->Busy = 0;
+}
+
+/**
+  * @brief  The function is called from the UART error interrupt, framing
+  * 		error of a shorted line or DMA error, the transfer is aborted
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_UART_ErrorCallback(OneWire_t* OW)
+{
+	OneWire_UART_t *U = OW->Ctx;
+
+	U->Error = 1;
+	U->Busy = 0;
+}
+
+/* Pin belongs to the UART, no pin access */
+const OneWire_Ops_t OneWire_UART_Ops =
+{
+	.SetMode	= NULL,
+	.SetLevel	= NULL,
+	.GetLevel	= NULL,
+	.Reset		= OneWire_UART_Reset,
+	.WriteBits	= OneWire_UART_WriteBits,
+	.ReadBits	= OneWire_UART_ReadBits,
+	.Xfer		= OneWire_UART_Xfer
+};
+
+#endif /* HAL_UART_MODULE_ENABLED */
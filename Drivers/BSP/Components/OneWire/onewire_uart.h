@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    onewire_uart.h
+  * @brief   This file contains all the constants parameters for the UART
+  * 		 OneWire driver
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Set up the UART in half-duplex (single wire) mode with the pin in
+  *		open-drain, 8N1, with DMA on both RX and TX, then call
+  *		OneWire_UART_Init before OneWire_Init. Forward the receive complete
+  *		and error interrupts to the driver:
+  *
+  *		void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+  *		{
+  *			if (huart == OW_UART.Uart) OneWire_UART_RxCpltCallback(&OW);
+  *		}
+  *
+  *		void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+  *		{
+  *			if (huart == OW_UART.Uart) OneWire_UART_ErrorCallback(&OW);
+  *		}
+  *
+  *		A UART error or a transfer not done within twice its frame time
+  *		plus ONEWIRE_UART_MARGIN is aborted, Reset then reports no
+  *		presence and Xfer returns HAL_ERROR.
+  *
+  *		Every 1-Wire bit is one UART byte, the echo received on the same
+  *		line gives the bit value. The OneWire_UART_t holding the DMA buffers
+  *		must be placed in RAM reachable by the DMA (not DTCM).
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_UART_H
+#define ONEWIRE_UART_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "onewire.h"
+
+/* UART Timing ---------------------------------------------------------------*/
+#define ONEWIRE_UART_BAUD_RESET			9600
+#define ONEWIRE_UART_BAUD_SLOT			115200
+#define ONEWIRE_UART_RESET				0xF0
+#define ONEWIRE_UART_BIT0				0x00
+#define ONEWIRE_UART_BIT1				0xFF
+
+/* Bits per DMA transfer, longer transfers are split */
+#ifndef ONEWIRE_UART_MAXBITS
+#define ONEWIRE_UART_MAXBITS			160
+#endif
+
+/* Time (us) added to the frame time before a transfer is aborted */
+#ifndef ONEWIRE_UART_MARGIN
+#define ONEWIRE_UART_MARGIN				1000
+#endif
+
+/* Data Structure ------------------------------------------------------------*/
+typedef struct
+{
+	UART_HandleTypeDef *Uart;
+	volatile uint8_t Busy;
+	volatile uint8_t Error;				/* Error interrupt in transfer */
+	uint32_t		Errors;				/* Transfers failed or timed out */
+	uint8_t			Tx[ONEWIRE_UART_MAXBITS] __ALIGNED(32);
+	uint8_t			Rx[ONEWIRE_UART_MAXBITS] __ALIGNED(32);
+} OneWire_UART_t;
+
+/* Bus Driver ----------------------------------------------------------------*/
+extern const OneWire_Ops_t OneWire_UART_Ops;
+
+/* External Function ---------------------------------------------------------*/
+void OneWire_UART_Init(OneWire_t* OW, OneWire_UART_t *U,
+		UART_HandleTypeDef *huart);
+uint8_t OneWire_UART_Reset(OneWire_t* OW);
+HAL_StatusTypeDef OneWire_UART_Xfer(OneWire_t* OW, const uint8_t *Tx,
+		uint16_t TxBits, uint8_t *Rx, uint16_t RxBits);
+void OneWire_UART_RxCpltCallback(OneWire_t* OW);
+void OneWire_UART_ErrorCallback(OneWire_t* OW);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_UART_H */
@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @brief   Host replacement for Core/Inc/main.h. Provides the subset of the
+  * 		 STM32H7 HAL/LL/CMSIS used by the BSP components, backed by the
+  * 		 1-Wire bus simulator
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		Put Host/Inc in front of the include path, see README.md
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* CMSIS ---------------------------------------------------------------------*/
+#define __weak				__attribute__((weak))
+#define __IO				volatile
+#define __ALIGNED(x)		__attribute__((aligned(x)))
+#define POSITION_VAL(VAL)	((uint32_t)__builtin_ctz(VAL))
+
+extern uint32_t SystemCoreClock;
+
+void Sim_DisableIrq(void);
+void Sim_EnableIrq(void);
+uint32_t Sim_GetPrimask(void);
+void Sim_Wfi(void);
+
+#define __disable_irq()		Sim_DisableIrq()
+#define __enable_irq()		Sim_EnableIrq()
+#define __get_PRIMASK()		Sim_GetPrimask()
+#define __WFI()				Sim_Wfi()
+#define __DMB()				__sync_synchronize()
+
+/* HAL Common ----------------------------------------------------------------*/
+typedef enum
+{
+	HAL_OK			= 0x00U,
+	HAL_ERROR		= 0x01U,
+	HAL_BUSY		= 0x02U,
+	HAL_TIMEOUT		= 0x03U
+} HAL_StatusTypeDef;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+/* GPIO ----------------------------------------------------------------------*/
+typedef struct
+{
+	__IO uint32_t	MODER;
+	__IO uint32_t	OTYPER;
+	__IO uint32_t	OSPEEDR;
+	__IO uint32_t	PUPDR;
+	__IO uint32_t	IDR;
+	__IO uint32_t	ODR;
+	__IO uint32_t	BSRR;
+	__IO uint32_t	LCKR;
+	__IO uint32_t	AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	uint32_t		Pin;
+	uint32_t		Mode;
+	uint32_t		Pull;
+	uint32_t		Speed;
+	uint32_t		Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0U,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+#define SIM_GPIO_PORTS		11U
+extern GPIO_TypeDef SimGPIO[SIM_GPIO_PORTS];
+
+#define GPIOA				(&SimGPIO[0])
+#define GPIOB				(&SimGPIO[1])
+#define GPIOC				(&SimGPIO[2])
+#define GPIOD				(&SimGPIO[3])
+#define GPIOE				(&SimGPIO[4])
+#define GPIOF				(&SimGPIO[5])
+#define GPIOG				(&SimGPIO[6])
+#define GPIOH				(&SimGPIO[7])
+#define GPIOI				(&SimGPIO[8])
+#define GPIOJ				(&SimGPIO[9])
+#define GPIOK				(&SimGPIO[10])
+
+#define GPIO_PIN_0			((uint16_t)0x0001)
+#define GPIO_PIN_1			((uint16_t)0x0002)
+#define GPIO_PIN_2			((uint16_t)0x0004)
+#define GPIO_PIN_3			((uint16_t)0x0008)
+#define GPIO_PIN_4			((uint16_t)0x0010)
+#define GPIO_PIN_5			((uint16_t)0x0020)
+#define GPIO_PIN_6			((uint16_t)0x0040)
+#define GPIO_PIN_7			((uint16_t)0x0080)
+#define GPIO_PIN_8			((uint16_t)0x0100)
+#define GPIO_PIN_9			((uint16_t)0x0200)
+#define GPIO_PIN_10			((uint16_t)0x0400)
+#define GPIO_PIN_11			((uint16_t)0x0800)
+#define GPIO_PIN_12			((uint16_t)0x1000)
+#define GPIO_PIN_13			((uint16_t)0x2000)
+#define GPIO_PIN_14			((uint16_t)0x4000)
+#define GPIO_PIN_15			((uint16_t)0x8000)
+#define GPIO_PIN_All		((uint16_t)0xFFFF)
+
+#define GPIO_MODE_INPUT		0x00000000U
+#define GPIO_MODE_OUTPUT_PP	0x00000001U
+#define GPIO_MODE_OUTPUT_OD	0x00000011U
+#define GPIO_NOPULL			0x00000000U
+#define GPIO_PULLUP			0x00000001U
+#define GPIO_SPEED_FREQ_LOW	0x00000000U
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin,
+		GPIO_PinState PinState);
+
+#define USE_FULL_LL_DRIVER
+#define LL_GPIO_MODE_INPUT	0x00000000U
+#define LL_GPIO_MODE_OUTPUT	0x00000001U
+
+void LL_GPIO_SetPinMode(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t Mode);
+void LL_GPIO_SetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask);
+void LL_GPIO_ResetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask);
+
+/* TIM -----------------------------------------------------------------------*/
+#define HAL_TIM_MODULE_ENABLED
+
+typedef struct
+{
+	__IO uint32_t	CCR[4];
+} TIM_TypeDef;
+
+typedef struct
+{
+	TIM_TypeDef		*Instance;
+	uint32_t		Channel;		/* Active channel in callback */
+} TIM_HandleTypeDef;
+
+#define SIM_TIMS			4U
+extern TIM_TypeDef SimTIM[SIM_TIMS];
+
+#define TIM2				(&SimTIM[0])
+#define TIM3				(&SimTIM[1])
+#define TIM4				(&SimTIM[2])
+#define TIM5				(&SimTIM[3])
+
+#define TIM_CHANNEL_1		0x00000000U
+#define TIM_CHANNEL_2		0x00000004U
+#define TIM_CHANNEL_3		0x00000008U
+#define TIM_CHANNEL_4		0x0000000CU
+
+/* Simulated timers count at 1 MHz with period 0xFFFF */
+uint32_t Sim_TimCounter(void);
+
+#define __HAL_TIM_GET_COUNTER(h)			Sim_TimCounter()
+#define __HAL_TIM_SET_COMPARE(h, ch, v)	((h)->Instance->CCR[(ch) >> 2] = (v))
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim,
+		uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim,
+		uint32_t Channel);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim);
+
+/* UART ----------------------------------------------------------------------*/
+#define HAL_UART_MODULE_ENABLED
+
+typedef struct
+{
+	uint32_t		Dummy;
+} USART_TypeDef;
+
+typedef struct
+{
+	uint32_t		BaudRate;
+	uint32_t		WordLength;
+	uint32_t		StopBits;
+	uint32_t		Parity;
+	uint32_t		Mode;
+	uint32_t		HwFlowCtl;
+	uint32_t		OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+	USART_TypeDef	*Instance;
+	UART_InitTypeDef Init;
+	volatile uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+#define HAL_UART_ERROR_NONE	0x00U
+#define HAL_UART_ERROR_FE	0x04U
+
+#define SIM_USARTS			4U
+extern USART_TypeDef SimUSART[SIM_USARTS];
+
+#define USART1				(&SimUSART[0])
+#define USART2				(&SimUSART[1])
+#define USART3				(&SimUSART[2])
+#define UART4				(&SimUSART[3])
+
+HAL_StatusTypeDef HAL_HalfDuplex_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+		const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart,
+		uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+/* DWT -----------------------------------------------------------------------*/
+extern volatile uint32_t SimDWT_CR, SimDWT_LAR, SimDEM_CR;
+volatile uint32_t *Sim_Cyccnt(void);
+
+#define  DWT_CR				SimDWT_CR
+#define  DWT_LAR			SimDWT_LAR
+#define  DWT_CYCCNT			(*Sim_Cyccnt())
+#define  DEM_CR				SimDEM_CR
+
+/* Private includes ----------------------------------------------------------*/
+#include "dwt.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define DS_Pin GPIO_PIN_10
+#define DS_GPIO_Port GPIOB
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
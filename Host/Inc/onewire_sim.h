@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    onewire_sim.h
+  * @brief   This file contains the 1-Wire bus simulator used by the host build.
+  * 		 Each bus is an open-drain line on a simulated GPIO pin with any
+  * 		 number of virtual DS18B20 attached
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		The simulated clock only advances through the timebase (DWT_CYCCNT)
+  *		and the GPIO calls, each access costs the cycles set in
+  *		OneWireSim_Cfg. Register writes done without a HAL/LL call (BSRR,
+  *		MODER) are latched at the next timebase access.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ONEWIRE_SIM_H
+#define ONEWIRE_SIM_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Bus Timing (us) -----------------------------------------------------------*/
+#define ONEWIRE_SIM_RESET_MIN		450		/* Low time seen as reset pulse */
+#define ONEWIRE_SIM_SAMPLE			30		/* Device sample point of a write */
+#define ONEWIRE_SIM_TX_HOLD			28		/* Device hold time of a read 0 */
+#define ONEWIRE_SIM_PD_WAIT			30		/* Presence pulse delay */
+#define ONEWIRE_SIM_PD_LOW			120		/* Presence pulse length */
+#define ONEWIRE_SIM_COPY_MS			10		/* Copy scratchpad busy time */
+#define ONEWIRE_SIM_SPU_WAIT		10		/* Strong pull-up delay allowed */
+#define ONEWIRE_SIM_SHORT			100		/* Short of ShortSlot */
+
+#define ONEWIRE_SIM_MAX_BUS			32
+#define ONEWIRE_SIM_MAX_IRQ			16
+#define ONEWIRE_SIM_MAX_UART		4
+
+/* Data Structure ------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t		CyccntCost;		/* Cycles per DWT_CYCCNT read */
+	uint32_t		GpioInitCost;	/* Cycles per HAL_GPIO_Init */
+	uint32_t		GpioIoCost;		/* Cycles per pin read/write */
+	uint32_t		IsrCost;		/* Cycles per interrupt entry and exit */
+} OneWireSim_Cfg_t;
+
+typedef struct
+{
+	uint64_t		IdleCycles;		/* Time spent in WFI */
+	uint64_t		IsrCycles;		/* Time spent in interrupts */
+	uint64_t		IrqLatencyMax;	/* Longest wait of a pending interrupt */
+	uint32_t		Irqs;
+	uint32_t		Ticks;			/* HAL_GetTick reads */
+} OneWireSim_Stat_t;
+
+typedef struct
+{
+	/* Identity and memory */
+	uint8_t			Rom[8];
+	uint8_t			Scratch[9];
+	uint8_t			Eeprom[3];
+	int16_t			Temp;			/* Die temperature in 1/16 deg C */
+	uint8_t			ConvPct;		/* Conversion time, % of datasheet max */
+	uint8_t			Alarm;
+	uint8_t			ConvPending;
+	uint8_t			Parasite;		/* Powered from the line */
+	uint64_t		BusyUntil;		/* Conversion / copy end, in cycles */
+	uint64_t		PowerFrom;		/* Strong pull-up needed from, in cycles */
+
+	/* Protocol state */
+	uint8_t			State;
+	uint8_t			Step;
+	uint8_t			TxSlot;
+	uint8_t			Next;
+	uint8_t			Buf[9];
+	uint16_t		Pos;
+	uint16_t		Len;
+} OneWireSim_Dev_t;
+
+typedef struct
+{
+	GPIO_TypeDef	*Port;
+	uint16_t		Pin;
+	OneWireSim_Dev_t *Dev;
+	uint16_t		DevCnt;
+
+	/* Line state */
+	UART_HandleTypeDef *Uart;		/* Line driven by UART, not GPIO */
+	uint8_t			MasterLow;
+	uint8_t			Short;			/* Line shorted to ground */
+	uint8_t			Faulted;		/* Short seen since the last reset */
+	uint32_t		ShortSlot;		/* Slot count shorting the line, 0 = never */
+	uint64_t		ShortUntil;		/* End of that short, in cycles */
+	uint64_t		FallAt;
+	uint64_t		HoldFrom;
+	uint64_t		HoldUntil;
+	uint8_t			Parasite;		/* Parasite powered device on bus */
+	uint8_t			Strong;			/* Line driven high push-pull */
+	uint64_t		SlotAt;			/* End of the last slot, in cycles */
+	uint64_t		SlotNs;			/* Driver host time at that end */
+	uint32_t		SlotTicks;		/* Tick reads at that end */
+
+	/* Statistics */
+	uint32_t		Resets;
+	uint32_t		Slots;
+	uint32_t		Brownouts;		/* Parasite device lost power busy */
+	uint32_t		FaultSlots;		/* Slots after the short before a reset */
+	uint64_t		SpuBus;			/* Longest command to pull-up, in cycles */
+	uint64_t		SpuHostNs;		/* Longest driver host time in there */
+	uint32_t		SpuLate;		/* Pull-ups after a tick read */
+} OneWireSim_Bus_t;
+
+extern OneWireSim_Cfg_t OneWireSim_Cfg;
+extern OneWireSim_Stat_t OneWireSim_Stat;
+
+/* External Function ---------------------------------------------------------*/
+void OneWireSim_Reset(void);
+OneWireSim_Bus_t *OneWireSim_AddBus(GPIO_TypeDef *Port, uint16_t Pin,
+		uint16_t DevCnt, uint32_t Seed);
+void OneWireSim_SetTemp(OneWireSim_Dev_t *Dev, float Temp);
+void OneWireSim_SetFamily(OneWireSim_Dev_t *Dev, uint8_t Family);
+void OneWireSim_SetParasite(OneWireSim_Bus_t *B, uint16_t Idx);
+uint64_t OneWireSim_Now(void);
+double OneWireSim_ToUs(uint64_t Cycles);
+void OneWireSim_Advance(uint32_t Cycles);
+void OneWireSim_Sync(void);
+void OneWireSim_AttachUart(OneWireSim_Bus_t *B, UART_HandleTypeDef *huart);
+void OneWireSim_UartRx(UART_HandleTypeDef *huart, uint8_t *Rx);
+void OneWireSim_UartTx(UART_HandleTypeDef *huart, const uint8_t *Tx,
+		uint16_t Len);
+void OneWireSim_UartAbort(UART_HandleTypeDef *huart);
+void OneWireSim_TimIrq(TIM_HandleTypeDef *htim, uint32_t Channel,
+		uint8_t Enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ONEWIRE_SIM_H */
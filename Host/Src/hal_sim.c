@@ -0,0 +1,238 @@
+/**
+  ******************************************************************************
+  * @file    hal_sim.c
+  * @brief   This file includes the host implementation of the HAL/LL/CMSIS
+  * 		 subset declared in Host/Inc/main.h
+  ******************************************************************************
+  */
+#include "main.h"
+#include "onewire_sim.h"
+
+uint32_t SystemCoreClock = 200000000U;
+GPIO_TypeDef SimGPIO[SIM_GPIO_PORTS];
+TIM_TypeDef SimTIM[SIM_TIMS];
+USART_TypeDef SimUSART[SIM_USARTS];
+volatile uint32_t SimDWT_CR, SimDWT_LAR, SimDEM_CR;
+
+/**
+  * @brief  Provides a tick value in millisecond
+  * @retval Tick value
+  */
+uint32_t HAL_GetTick(void)
+{
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+	OneWireSim_Stat.Ticks++;
+	return (uint32_t)(OneWireSim_Now() / (SystemCoreClock / 1000U));
+}
+
+/**
+  * @brief  Provides a blocking delay in millisecond
+  * @param  Delay	Delay in millisecond
+  */
+void HAL_Delay(uint32_t Delay)
+{
+	uint32_t tickstart = HAL_GetTick();
+
+	while ((HAL_GetTick() - tickstart) < Delay)
+	{
+		OneWireSim_Advance(SystemCoreClock / 100000U);
+	}
+}
+
+/**
+  * @brief  Initializes the GPIOx peripheral, mode only
+  * @param  GPIOx		GPIO port
+  * @param  GPIO_Init	GPIO configuration
+  */
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+	for (uint32_t pos = 0; pos < 16; pos++)
+	{
+		if (!(GPIO_Init->Pin & (1U << pos))) continue;
+
+		GPIOx->MODER &= ~(3U << (pos * 2));
+		GPIOx->MODER |= (GPIO_Init->Mode & 3U) << (pos * 2);
+		GPIOx->OTYPER &= ~(1U << pos);
+		GPIOx->OTYPER |= ((GPIO_Init->Mode >> 4) & 1U) << pos;
+	}
+	OneWireSim_Advance(OneWireSim_Cfg.GpioInitCost);
+}
+
+/**
+  * @brief  Reads the specified input port pin
+  * @retval The input port pin value
+  * @param  GPIOx		GPIO port
+  * @param  GPIO_Pin	GPIO pin
+  */
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/**
+  * @brief  Sets or clears the selected data port bit
+  * @param  GPIOx		GPIO port
+  * @param  GPIO_Pin	GPIO pin
+  * @param  PinState	GPIO_PIN_RESET or GPIO_PIN_SET
+  */
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin,
+		GPIO_PinState PinState)
+{
+	GPIOx->BSRR = (PinState != GPIO_PIN_RESET) ? GPIO_Pin :
+			(uint32_t)GPIO_Pin << 16;
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+}
+
+/**
+  * @brief  Configure gpio mode for a dedicated pin
+  * @param  GPIOx	GPIO port
+  * @param  Pin		GPIO pin
+  * @param  Mode	LL_GPIO_MODE_INPUT or LL_GPIO_MODE_OUTPUT
+  */
+void LL_GPIO_SetPinMode(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t Mode)
+{
+	uint32_t pos = __builtin_ctz(Pin);
+
+	GPIOx->MODER = (GPIOx->MODER & ~(3U << (pos * 2))) | (Mode << (pos * 2));
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+}
+
+/**
+  * @brief  Set several pins to high level on dedicated gpio port
+  * @param  GPIOx	GPIO port
+  * @param  PinMask	GPIO pins
+  */
+void LL_GPIO_SetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+	GPIOx->BSRR = PinMask;
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+}
+
+/**
+  * @brief  Set several pins to low level on dedicated gpio port
+  * @param  GPIOx	GPIO port
+  * @param  PinMask	GPIO pins
+  */
+void LL_GPIO_ResetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+	GPIOx->BSRR = PinMask << 16;
+	OneWireSim_Advance(OneWireSim_Cfg.GpioIoCost);
+}
+
+/**
+  * @brief  Starts the TIM Base generation, simulated timers always count
+  * @retval HAL status
+  * @param  htim	TIM handle
+  */
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+	(void)htim;
+	return HAL_OK;
+}
+
+/**
+  * @brief  Starts the TIM Output Compare signal generation in interrupt mode
+  * @retval HAL status
+  * @param  htim	TIM handle
+  * @param  Channel	TIM_CHANNEL_1 - 4
+  */
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef *htim,
+		uint32_t Channel)
+{
+	OneWireSim_TimIrq(htim, Channel, 1);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Stops the TIM Output Compare signal generation in interrupt mode
+  * @retval HAL status
+  * @param  htim	TIM handle
+  * @param  Channel	TIM_CHANNEL_1 - 4
+  */
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef *htim,
+		uint32_t Channel)
+{
+	OneWireSim_TimIrq(htim, Channel, 0);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Output Compare callback in non-blocking mode
+  * @param  htim	TIM handle
+  */
+__weak void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+	(void)htim;
+}
+
+/**
+  * @brief  Initializes the half-duplex mode, only the baud rate is simulated
+  * @retval HAL status
+  * @param  huart	UART handle
+  */
+HAL_StatusTypeDef HAL_HalfDuplex_Init(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+	OneWireSim_Advance(OneWireSim_Cfg.GpioInitCost);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Sends an amount of data in DMA mode
+  * @retval HAL status
+  * @param  huart	UART handle
+  * @param  pData	Pointer to data buffer
+  * @param  Size	Amount of data elements
+  */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+		const uint8_t *pData, uint16_t Size)
+{
+	OneWireSim_UartTx(huart, pData, Size);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Receives an amount of data in DMA mode
+  * @retval HAL status
+  * @param  huart	UART handle
+  * @param  pData	Pointer to data buffer
+  * @param  Size	Amount of data elements
+  */
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart,
+		uint8_t *pData, uint16_t Size)
+{
+	(void)Size;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	OneWireSim_UartRx(huart, pData);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Aborts the ongoing DMA transfers
+  * @retval HAL status
+  * @param  huart	UART handle
+  */
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart)
+{
+	OneWireSim_UartAbort(huart);
+	return HAL_OK;
+}
+
+/**
+  * @brief  Rx Transfer completed callback
+  * @param  huart	UART handle
+  */
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+}
+
+/**
+  * @brief  UART error callback
+  * @param  huart	UART handle
+  */
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+}
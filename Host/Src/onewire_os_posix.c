@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    onewire_os_posix.c
+  * @brief   This file includes the POSIX port of the OneWire OS abstraction
+  * 		 for the host build, recursive pthread mutex per bus. Waits
+  * 		 yield to other threads, time comes from the HAL timebase
+  ******************************************************************************
+  */
+#include "onewire.h"
+#include "dwt.h"
+#include <pthread.h>
+#include <sched.h>
+
+/* Buses with a mutex */
+#define ONEWIRE_OS_MAX_BUS			32
+
+/* Waits from this length (us) sleep, shorter ones yield then spin */
+#define ONEWIRE_OS_TICK_US			1000
+
+static pthread_mutex_t OsMutex[ONEWIRE_OS_MAX_BUS];
+static OneWire_t *OsOwner[ONEWIRE_OS_MAX_BUS];
+static uint8_t OsCnt;
+static pthread_mutex_t OsInitMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+  * @brief  The function is used to create the mutex of a bus, a handle
+  * 		initialized again gets its mutex back
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_OS_Init(OneWire_t* OW)
+{
+	pthread_mutexattr_t attr;
+	uint8_t i;
+
+	if (OW->Mutex != NULL) return;
+
+	pthread_mutex_lock(&OsInitMutex);
+	for (i = 0; i < OsCnt && OsOwner[i] != OW; i++) {}
+	if (i == OsCnt && OsCnt < ONEWIRE_OS_MAX_BUS)
+	{
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&OsMutex[i], &attr);
+		pthread_mutexattr_destroy(&attr);
+		OsOwner[i] = OW;
+		OsCnt++;
+	}
+	if (i < OsCnt) OW->Mutex = &OsMutex[i];
+	pthread_mutex_unlock(&OsInitMutex);
+}
+
+/**
+  * @brief  The function is used to take the bus for a transaction
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_OS_Lock(OneWire_t* OW)
+{
+	if (OW->Mutex != NULL) pthread_mutex_lock(OW->Mutex);
+}
+
+/**
+  * @brief  The function is used to give the bus back
+  * @param  OW		OneWire HandleTypedef
+  */
+void OneWire_OS_Unlock(OneWire_t* OW)
+{
+	if (OW->Mutex != NULL) pthread_mutex_unlock(OW->Mutex);
+}
+
+/**
+  * @brief  The function is used to wait in millisecond
+  * @param  Ms		Period in millisecond
+  */
+void OneWire_OS_Delay(uint32_t Ms)
+{
+	sched_yield();
+	HAL_Delay(Ms);
+}
+
+/**
+  * @brief  The function is used to wait in microsecond where running late
+  * 		does no harm
+  * @param  Us		Period in microsecond, at least
+  */
+void OneWire_OS_Delay_us(uint32_t Us)
+{
+	if (Us >= ONEWIRE_OS_TICK_US)
+	{
+		OneWire_OS_Delay((Us + ONEWIRE_OS_TICK_US - 1) / ONEWIRE_OS_TICK_US);
+		return;
+	}
+	sched_yield();
+	DwtDelay_us(Us);
+}
+
+/**
+  * @brief  The function is used to give the core away once while polling
+  */
+void OneWire_OS_Yield(void)
+{
+	sched_yield();
+}
@@ -0,0 +1,1021 @@
+/**
+  ******************************************************************************
+  * @file    onewire_sim.c
+  * @brief   This file includes the 1-Wire bus and DS18B20 device simulator
+  ******************************************************************************
+  */
+#include "onewire_sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Device protocol state */
+enum
+{
+	DEV_IDLE,			/* Waiting for reset */
+	DEV_ROMCMD,			/* Receiving ROM command */
+	DEV_MATCH,			/* Receiving ROM to match */
+	DEV_SEARCH,			/* Search triplets */
+	DEV_FUNCCMD,		/* Receiving function command */
+	DEV_TX,				/* Sending Buf */
+	DEV_WRITESP,		/* Receiving TH, TL, config */
+	DEV_BUSY			/* Sending busy status */
+};
+
+OneWireSim_Cfg_t OneWireSim_Cfg = {
+	.CyccntCost		= 10,
+	.GpioInitCost	= 180,
+	.GpioIoCost		= 12,
+	.IsrCost		= 150,
+};
+OneWireSim_Stat_t OneWireSim_Stat;
+
+static uint64_t Now;
+static OneWireSim_Bus_t Bus[ONEWIRE_SIM_MAX_BUS];
+static uint8_t BusCnt;
+static uint16_t PortUsed;
+
+/* Timer compare interrupts */
+static struct
+{
+	TIM_HandleTypeDef *Tim;
+	uint32_t		Channel;
+	uint64_t		Seen;			/* Matches before are handled */
+} Irq[ONEWIRE_SIM_MAX_IRQ];
+static uint8_t IrqCnt, IrqMasked, InIsr;
+
+/* UART driving a bus, DMA moves the whole buffer */
+static struct
+{
+	UART_HandleTypeDef *Uart;
+	OneWireSim_Bus_t *Bus;
+	const uint8_t	*Tx;
+	uint8_t			*Rx;
+	uint16_t		Len;
+	uint32_t		Pos;			/* Half bit index */
+	uint64_t		Start;
+	uint64_t		Half;			/* Half bit time in cycles */
+	uint8_t			Cplt;			/* Receive complete interrupt pending */
+	uint8_t			Error;			/* Framing error, stop bit read low */
+} Uart[ONEWIRE_SIM_MAX_UART];
+static uint8_t UartCnt;
+
+/* Host time in the simulator, kept apart from driver time while a parasite
+ * bus is simulated */
+static uint8_t HostTimed, HostDepth;
+static uint64_t HostEnter, HostSim, HostCyc;
+
+/**
+  * @brief  The internal function is used to get host time
+  * @retval Time in nanosecond
+  */
+static uint64_t Sim_HostNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
+
+/**
+  * @brief  The internal function is used to enter the simulated clock
+  */
+static void Sim_Enter(void)
+{
+	if (HostTimed && HostDepth++ == 0) HostEnter = Sim_HostNs();
+}
+
+/**
+  * @brief  The internal function is used to leave the simulated clock
+  */
+static void Sim_Leave(void)
+{
+	if (HostTimed && HostDepth && --HostDepth == 0)
+	{
+		HostSim += Sim_HostNs() - HostEnter;
+	}
+}
+
+/**
+  * @brief  The internal function is used to get host time spent outside the
+  * 		simulator. The simulated time does not move while the driver
+  * 		computes, this is a lower bound of that time on a target
+  * @retval Time in nanosecond
+  */
+static uint64_t Sim_DriverNs(void)
+{
+	return (HostDepth ? HostEnter : Sim_HostNs()) - HostSim;
+}
+
+/**
+  * @brief  The internal function is used to convert microsecond to cycles
+  * @retval Cycles
+  * @param  us		Time in microsecond
+  */
+static uint64_t Sim_Us(uint32_t us)
+{
+	return (uint64_t)us * (SystemCoreClock / 1000000U);
+}
+
+/**
+  * @brief  The internal function is used to calculate Dallas CRC8
+  * @retval CRC8
+  * @param  Addr	Pointer to data
+  * @param  Len		Number of byte
+  */
+static uint8_t Sim_CRC8(const uint8_t *Addr, uint8_t Len)
+{
+	uint8_t crc = 0;
+
+	while (Len--)
+	{
+		uint8_t inbyte = *Addr++;
+		for (uint8_t i = 8; i; i--)
+		{
+			uint8_t mix = (crc ^ inbyte) & 0x01;
+			crc >>= 1;
+			crc ^= (mix) ? 0x8C : 0;
+			inbyte >>= 1;
+		}
+	}
+	return crc;
+}
+
+/**
+  * @brief  The internal function is used to latch a finished conversion into
+  * 		the scratchpad and update the alarm flag
+  * @param  Dev		Simulated device
+  */
+static void Dev_Update(OneWireSim_Dev_t *Dev)
+{
+	int16_t raw, t;
+	uint8_t res;
+
+	if (!Dev->ConvPending || (Now < Dev->BusyUntil)) return;
+	Dev->ConvPending = 0;
+
+	/* Undefined low bits read as zero at lower resolution */
+	res = ((Dev->Scratch[4] & 0x60) >> 5) + 9;
+	raw = Dev->Temp & (int16_t)~((1 << (12 - res)) - 1);
+	Dev->Scratch[0] = (uint8_t)raw;
+	Dev->Scratch[1] = (uint8_t)(raw >> 8);
+	Dev->Scratch[6] = 0x10 - (raw & 0x0F);
+	Dev->Scratch[8] = Sim_CRC8(Dev->Scratch, 8);
+
+	/* Alarm compares the integer part against TH and TL */
+	t = raw >> 4;
+	Dev->Alarm = (t >= (int8_t)Dev->Scratch[2]) ||
+			(t <= (int8_t)Dev->Scratch[3]);
+}
+
+/**
+  * @brief  The internal function is used to get the bit a device drives at
+  * 		the start of a slot
+  * @retval -1 if the device listens in this slot, otherwise bit sent
+  * @param  Dev		Simulated device
+  */
+static int Dev_TxBit(OneWireSim_Dev_t *Dev)
+{
+	int bit = -1;
+	uint8_t rom;
+
+	switch (Dev->State)
+	{
+		case DEV_SEARCH:
+			rom = (Dev->Rom[Dev->Pos >> 3] >> (Dev->Pos & 7)) & 1;
+			if (Dev->Step == 0) {
+				bit = rom;
+				Dev->Step = 1;
+			} else if (Dev->Step == 1) {
+				bit = !rom;
+				Dev->Step = 2;
+			}
+			break;
+		case DEV_TX:
+			bit = 1;
+			if (Dev->Pos < Dev->Len)
+			{
+				bit = (Dev->Buf[Dev->Pos >> 3] >> (Dev->Pos & 7)) & 1;
+				if (++Dev->Pos == Dev->Len && Dev->Next != DEV_IDLE)
+				{
+					Dev->State = Dev->Next;
+					Dev->Pos = 0;
+					Dev->Buf[0] = 0;
+				}
+			}
+			break;
+		case DEV_BUSY:
+			/* Parasite powered devices cannot pull the line */
+			Dev_Update(Dev);
+			if (!Dev->Parasite) bit = (Now >= Dev->BusyUntil) ? 1 : 0;
+			break;
+		default:
+			break;
+	}
+	return bit;
+}
+
+/**
+  * @brief  The internal function is used to start a function command
+  * @param  Dev		Simulated device
+  * @param  Cmd		Function command
+  */
+static void Dev_Function(OneWireSim_Dev_t *Dev, uint8_t Cmd)
+{
+	uint8_t res;
+
+	Dev->Pos = 0;
+	Dev->Next = DEV_IDLE;
+	Dev_Update(Dev);
+
+	switch (Cmd)
+	{
+		case 0x44:	/* Convert T */
+			res = ((Dev->Scratch[4] & 0x60) >> 5);
+			Dev->BusyUntil = Now + Sim_Us(93750U * Dev->ConvPct / 100U) *
+					(1U << res);
+			Dev->ConvPending = 1;
+			Dev->PowerFrom = Now + Sim_Us(ONEWIRE_SIM_SPU_WAIT);
+			Dev->State = DEV_BUSY;
+			break;
+		case 0xBE:	/* Read scratchpad */
+			memcpy(Dev->Buf, Dev->Scratch, 9);
+			Dev->Len = 72;
+			Dev->State = DEV_TX;
+			break;
+		case 0x4E:	/* Write scratchpad */
+			memset(Dev->Buf, 0, sizeof(Dev->Buf));
+			Dev->State = DEV_WRITESP;
+			break;
+		case 0x48:	/* Copy scratchpad */
+			memcpy(Dev->Eeprom, &Dev->Scratch[2], 3);
+			Dev->BusyUntil = Now + Sim_Us(ONEWIRE_SIM_COPY_MS * 1000U);
+			Dev->PowerFrom = Now + Sim_Us(ONEWIRE_SIM_SPU_WAIT);
+			Dev->State = DEV_BUSY;
+			break;
+		case 0xB8:	/* Recall EEPROM */
+			memcpy(&Dev->Scratch[2], Dev->Eeprom, 3);
+			Dev->Scratch[8] = Sim_CRC8(Dev->Scratch, 8);
+			Dev->BusyUntil = Now;
+			Dev->State = DEV_BUSY;
+			break;
+		case 0xB4:	/* Read power supply, parasite powered pulls low */
+			Dev->Buf[0] = Dev->Parasite ? 0x00 : 0x01;
+			Dev->Len = 1;
+			Dev->State = DEV_TX;
+			break;
+		default:
+			Dev->State = DEV_IDLE;
+			break;
+	}
+}
+
+/**
+  * @brief  The internal function is used to feed a written bit to a device
+  * @param  Dev		Simulated device
+  * @param  bit		Bit written by master
+  */
+static void Dev_RxBit(OneWireSim_Dev_t *Dev, uint8_t bit)
+{
+	uint8_t rom;
+
+	switch (Dev->State)
+	{
+		case DEV_ROMCMD:
+		case DEV_FUNCCMD:
+			Dev->Buf[0] |= bit << Dev->Pos;
+			if (++Dev->Pos < 8) break;
+			Dev->Pos = 0;
+			if (Dev->State == DEV_FUNCCMD)
+			{
+				Dev_Function(Dev, Dev->Buf[0]);
+				break;
+			}
+			switch (Dev->Buf[0])
+			{
+				case 0x33:	/* Read ROM */
+					memcpy(Dev->Buf, Dev->Rom, 8);
+					Dev->Len = 64;
+					Dev->Next = DEV_FUNCCMD;
+					Dev->State = DEV_TX;
+					break;
+				case 0x55:	/* Match ROM */
+					Dev->State = DEV_MATCH;
+					break;
+				case 0xCC:	/* Skip ROM */
+					Dev->Buf[0] = 0;
+					Dev->State = DEV_FUNCCMD;
+					break;
+				case 0xEC:	/* Alarm search */
+					Dev_Update(Dev);
+					Dev->Step = 0;
+					Dev->State = Dev->Alarm ? DEV_SEARCH : DEV_IDLE;
+					break;
+				case 0xF0:	/* Search ROM */
+					Dev->Step = 0;
+					Dev->State = DEV_SEARCH;
+					break;
+				default:
+					Dev->State = DEV_IDLE;
+					break;
+			}
+			break;
+		case DEV_MATCH:
+		case DEV_SEARCH:
+			if (Dev->State == DEV_SEARCH && Dev->Step != 2) break;
+			rom = (Dev->Rom[Dev->Pos >> 3] >> (Dev->Pos & 7)) & 1;
+			if (bit != rom)
+			{
+				Dev->State = DEV_IDLE;
+				break;
+			}
+			Dev->Step = 0;
+			if (++Dev->Pos == 64)
+			{
+				Dev->Pos = 0;
+				Dev->Buf[0] = 0;
+				Dev->State = DEV_FUNCCMD;
+			}
+			break;
+		case DEV_WRITESP:
+			Dev->Buf[Dev->Pos >> 3] |= bit << (Dev->Pos & 7);
+			if (++Dev->Pos < 24) break;
+			Dev->Scratch[2] = Dev->Buf[0];
+			Dev->Scratch[3] = Dev->Buf[1];
+			Dev->Scratch[4] = (Dev->Buf[2] & 0x60) | 0x1F;
+			Dev->Scratch[8] = Sim_CRC8(Dev->Scratch, 8);
+			Dev->State = DEV_IDLE;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  The internal function is used to apply a master line change
+  * @param  B		Simulated bus
+  * @param  Low		Master pulls line low
+  * @param  t		Time of the edge in cycles
+  */
+static void Bus_Edge(OneWireSim_Bus_t *B, uint8_t Low, uint64_t t)
+{
+	uint8_t hold = 0;
+	uint64_t dur;
+
+	if (Low == B->MasterLow) return;
+	B->MasterLow = Low;
+
+	if (Low)
+	{
+		/* Falling edge starts a slot, devices sending 0 hold the line */
+		B->FallAt = t;
+		for (uint16_t i = 0; i < B->DevCnt; i++)
+		{
+			int bit = Dev_TxBit(&B->Dev[i]);
+			B->Dev[i].TxSlot = (bit >= 0);
+			if (bit == 0) hold = 1;
+		}
+		if (hold)
+		{
+			B->HoldFrom = t;
+			B->HoldUntil = t + Sim_Us(ONEWIRE_SIM_TX_HOLD);
+		}
+		return;
+	}
+
+	dur = t - B->FallAt;
+	if (dur >= Sim_Us(ONEWIRE_SIM_RESET_MIN))
+	{
+		/* Reset pulse, every device answers with presence */
+		B->Resets++;
+		B->Faulted = 0;
+		for (uint16_t i = 0; i < B->DevCnt; i++)
+		{
+			OneWireSim_Dev_t *Dev = &B->Dev[i];
+			Dev_Update(Dev);
+			Dev->State = DEV_ROMCMD;
+			Dev->Pos = 0;
+			Dev->Buf[0] = 0;
+			hold = 1;
+		}
+		if (hold)
+		{
+			B->HoldFrom = t + Sim_Us(ONEWIRE_SIM_PD_WAIT);
+			B->HoldUntil = B->HoldFrom + Sim_Us(ONEWIRE_SIM_PD_LOW);
+		}
+		return;
+	}
+
+	/* Write slot, devices sample the line after ONEWIRE_SIM_SAMPLE */
+	B->Slots++;
+	if (B->Parasite)
+	{
+		B->SlotAt = t;
+		B->SlotNs = Sim_DriverNs();
+		B->SlotTicks = OneWireSim_Stat.Ticks;
+	}
+	if (B->Faulted) B->FaultSlots++;
+	if (B->ShortSlot && B->Slots >= B->ShortSlot)
+	{
+		/* Short from this slot on, the master sees it from now */
+		B->ShortSlot = 0;
+		B->ShortUntil = t + Sim_Us(ONEWIRE_SIM_SHORT);
+		B->Faulted = 1;
+	}
+	for (uint16_t i = 0; i < B->DevCnt; i++)
+	{
+		if (!B->Dev[i].TxSlot)
+		{
+			Dev_RxBit(&B->Dev[i], dur < Sim_Us(ONEWIRE_SIM_SAMPLE));
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to check the supply of parasite
+  * 		powered devices, a conversion or copy without strong pull-up
+  * 		resets the device to its power-on scratchpad. The time from
+  * 		the command slot to the strong pull-up is kept, in bus time and
+  * 		in host time of the driver computing after its last cycle
+  * 		counter read, the simulated time stands still while it computes
+  * @param  B		Simulated bus
+  * @param  Strong	Line actively driven high
+  */
+static void Bus_Power(OneWireSim_Bus_t *B, uint8_t Strong)
+{
+	uint64_t from, ns;
+
+	for (uint16_t i = 0; Strong && !B->Strong && i < B->DevCnt; i++)
+	{
+		OneWireSim_Dev_t *Dev = &B->Dev[i];
+
+		/* Device started by the last slot */
+		if (!Dev->Parasite || Dev->State != DEV_BUSY) continue;
+		if (Dev->PowerFrom != B->SlotAt + Sim_Us(ONEWIRE_SIM_SPU_WAIT)) continue;
+
+		from = (HostCyc > B->SlotNs) ? HostCyc : B->SlotNs;
+		ns = Sim_DriverNs() - from;
+		if (Now - B->SlotAt > B->SpuBus) B->SpuBus = Now - B->SlotAt;
+		if (ns > B->SpuHostNs) B->SpuHostNs = ns;
+		if (OneWireSim_Stat.Ticks != B->SlotTicks) B->SpuLate++;
+		break;
+	}
+	B->Strong = Strong;
+	if (Strong) return;
+
+	for (uint16_t i = 0; i < B->DevCnt; i++)
+	{
+		OneWireSim_Dev_t *Dev = &B->Dev[i];
+
+		if (!Dev->Parasite || Dev->State != DEV_BUSY) continue;
+		if (Now < Dev->PowerFrom || Now >= Dev->BusyUntil) continue;
+
+		Dev->ConvPending = 0;
+		Dev->BusyUntil = Now;
+		Dev->State = DEV_IDLE;
+		Dev->Scratch[0] = 0x50;
+		Dev->Scratch[1] = 0x05;
+		memcpy(&Dev->Scratch[2], Dev->Eeprom, 3);
+		Dev->Scratch[6] = 0x0C;
+		Dev->Scratch[8] = Sim_CRC8(Dev->Scratch, 8);
+		B->Brownouts++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to get line level
+  * @retval Line level
+  * @param  B		Simulated bus
+  * @param  t		Time in cycles
+  */
+static uint8_t Bus_Level(OneWireSim_Bus_t *B, uint64_t t)
+{
+	if (B->MasterLow || B->Short || t < B->ShortUntil) return 0;
+	return ((t >= B->HoldFrom) && (t < B->HoldUntil)) ? 0 : 1;
+}
+
+/**
+  * @brief  The internal function is used to get the pins in output mode
+  * @retval Pin mask
+  * @param  Moder	Port mode register
+  */
+static uint32_t Sim_Outputs(uint32_t Moder)
+{
+	/* Mode 01 per pin, then compress even bits */
+	uint32_t x = Moder & ~(Moder >> 1) & 0x55555555U;
+	x = (x | (x >> 1)) & 0x33333333U;
+	x = (x | (x >> 2)) & 0x0F0F0F0FU;
+	x = (x | (x >> 4)) & 0x00FF00FFU;
+	x = (x | (x >> 8)) & 0x0000FFFFU;
+	return x;
+}
+
+/**
+  * @brief  The function is used to latch GPIO register changes into the
+  * 		simulated buses and refresh the input data registers
+  */
+void OneWireSim_Sync(void)
+{
+	/* Apply BSRR writes, set has priority over reset */
+	for (uint8_t p = 0; p < SIM_GPIO_PORTS; p++)
+	{
+		GPIO_TypeDef *Port = &SimGPIO[p];
+
+		if (!(PortUsed & (1U << p))) continue;
+		uint32_t bsrr = Port->BSRR;
+		if (bsrr)
+		{
+			Port->ODR = (Port->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFFU);
+			Port->BSRR = 0;
+		}
+		/* Outputs read back their level, inputs are pulled up */
+		Port->IDR = ~Sim_Outputs(Port->MODER) | Port->ODR;
+		Port->IDR &= 0xFFFFU;
+	}
+
+	for (uint8_t b = 0; b < BusCnt; b++)
+	{
+		OneWireSim_Bus_t *B = &Bus[b];
+		if (B->Uart) continue;
+
+		uint8_t out = (Sim_Outputs(B->Port->MODER) & B->Pin) != 0;
+		uint8_t low = out && !(B->Port->ODR & B->Pin);
+
+		Bus_Edge(B, low, Now);
+		if (B->Parasite)
+		{
+			/* Push-pull output high */
+			Bus_Power(B, out && !low && !(B->Port->OTYPER & B->Pin));
+		}
+		if (Bus_Level(B, Now))
+		{
+			B->Port->IDR |= B->Pin;
+		} else {
+			B->Port->IDR &= ~(uint32_t)B->Pin;
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to find the next timer interrupt
+  * @retval Index in Irq, -1 if no interrupt enabled
+  * @param  At		Time of the interrupt in cycles
+  */
+static int Sim_NextIrq(uint64_t *At)
+{
+	uint64_t us = SystemCoreClock / 1000000U;
+	int idx = -1;
+
+	for (uint8_t i = 0; i < IrqCnt; i++)
+	{
+		/* Compare matches on the first tick with CNT == CCR, a match while
+		 * interrupts are masked stays pending */
+		uint64_t tick = (Irq[i].Seen + us - 1) / us;
+		uint32_t ccr = Irq[i].Tim->Instance->CCR[Irq[i].Channel >> 2];
+		uint64_t t = (tick + ((ccr - tick) & 0xFFFFU)) * us;
+		if (idx < 0 || t < *At)
+		{
+			*At = t;
+			idx = i;
+		}
+	}
+
+	/* Receive complete at the end of the last stop bit */
+	for (uint8_t i = 0; i < UartCnt; i++)
+	{
+		uint64_t t = Uart[i].Start + Uart[i].Half * 20U * Uart[i].Len;
+		if (Uart[i].Cplt && (idx < 0 || t < *At))
+		{
+			*At = t;
+			idx = ONEWIRE_SIM_MAX_IRQ + i;
+		}
+	}
+	return idx;
+}
+
+/**
+  * @brief  The internal function is used to run the UART frames on the line
+  * 		until the given time. Edges are at bit start, the receiver
+  * 		samples at mid bit. A stop bit read low is a framing error, the
+  * 		transfer ends with that byte and the error interrupt is raised
+  * @param  Limit	Time in cycles
+  */
+static void Sim_RunUart(uint64_t Limit)
+{
+	for (uint8_t i = 0; i < UartCnt; i++)
+	{
+		while (Uart[i].Pos < Uart[i].Len * 20U)
+		{
+			uint64_t t = Uart[i].Start + Uart[i].Half * Uart[i].Pos;
+			uint16_t byte = Uart[i].Pos / 20U;
+			uint8_t bit = (Uart[i].Pos % 20U) / 2U;
+
+			if (t > Limit) break;
+			if (t > Now) Now = t;
+
+			if (!(Uart[i].Pos & 1U))
+			{
+				/* Start bit low, stop bit high, data LSB first */
+				uint8_t level = (bit == 9) ? 1 : (bit == 0) ? 0 :
+						(Uart[i].Tx[byte] >> (bit - 1)) & 1;
+				Bus_Edge(Uart[i].Bus, !level, t);
+			} else if (bit >= 1 && bit <= 8 && Uart[i].Rx) {
+				if (bit == 1) Uart[i].Rx[byte] = 0;
+				Uart[i].Rx[byte] |= Bus_Level(Uart[i].Bus, t) << (bit - 1);
+			} else if (bit == 9 && !Bus_Level(Uart[i].Bus, t)) {
+				Uart[i].Error = 1;
+				Uart[i].Len = byte + 1;
+			}
+			Uart[i].Pos++;
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to run the interrupts due until
+  * 		the given time
+  * @param  Limit	Time in cycles
+  */
+static void Sim_RunIrq(uint64_t Limit)
+{
+	uint64_t at, start;
+	int i;
+
+	while (!IrqMasked && !InIsr && (i = Sim_NextIrq(&at)) >= 0 && at <= Limit)
+	{
+		OneWireSim_Sync();
+		Sim_RunUart(at);
+		if (at > Now) Now = at;
+		OneWireSim_Sync();
+
+		/* Pending since its compare match, masked or behind another one */
+		if (Now - at > OneWireSim_Stat.IrqLatencyMax)
+		{
+			OneWireSim_Stat.IrqLatencyMax = Now - at;
+		}
+
+		InIsr = 1;
+		start = Now;
+		Now += OneWireSim_Cfg.IsrCost;
+		if (i < ONEWIRE_SIM_MAX_IRQ)
+		{
+			Irq[i].Seen = start + 1;
+			Irq[i].Tim->Channel = 1U << (Irq[i].Channel >> 2);
+			HAL_TIM_OC_DelayElapsedCallback(Irq[i].Tim);
+		} else {
+			uint8_t u = i - ONEWIRE_SIM_MAX_IRQ;
+
+			Uart[u].Cplt = 0;
+			if (Uart[u].Error)
+			{
+				Uart[u].Uart->ErrorCode = HAL_UART_ERROR_FE;
+				HAL_UART_ErrorCallback(Uart[u].Uart);
+			} else {
+				HAL_UART_RxCpltCallback(Uart[u].Uart);
+			}
+		}
+		OneWireSim_Sync();
+		OneWireSim_Stat.IsrCycles += Now - start;
+		OneWireSim_Stat.Irqs++;
+		InIsr = 0;
+	}
+
+	/* No match left until the limit */
+	for (uint8_t j = 0; !IrqMasked && !InIsr && j < IrqCnt; j++)
+	{
+		if (Irq[j].Seen <= Limit) Irq[j].Seen = Limit + 1;
+	}
+}
+
+/**
+  * @brief  The function is used to advance the simulated clock
+  * @param  Cycles	Number of core cycles
+  */
+void OneWireSim_Advance(uint32_t Cycles)
+{
+	uint64_t target = Now + Cycles;
+
+	/* Changes made since the last access happened at the current time */
+	Sim_Enter();
+	OneWireSim_Sync();
+	Sim_RunIrq(target);
+	Sim_RunUart(target);
+	if (Now < target) Now = target;
+	OneWireSim_Sync();
+	Sim_Leave();
+}
+
+/**
+  * @brief  The function is used to enable or disable a timer compare
+  * 		interrupt
+  * @param  htim	Timer handle
+  * @param  Channel	TIM_CHANNEL_1 - 4
+  * @param  Enable	Enable = 1, Disable = 0
+  */
+void OneWireSim_TimIrq(TIM_HandleTypeDef *htim, uint32_t Channel,
+		uint8_t Enable)
+{
+	for (uint8_t i = 0; i < IrqCnt; i++)
+	{
+		if (Irq[i].Tim == htim && Irq[i].Channel == Channel)
+		{
+			if (!Enable) Irq[i] = Irq[--IrqCnt];
+			return;
+		}
+	}
+	if (Enable && IrqCnt < ONEWIRE_SIM_MAX_IRQ)
+	{
+		Irq[IrqCnt].Tim = htim;
+		Irq[IrqCnt].Channel = Channel;
+		Irq[IrqCnt].Seen = Now;
+		IrqCnt++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to find the UART of a handle
+  * @retval UART index, creates one if needed
+  * @param  huart	UART handle
+  */
+static uint8_t Sim_Uart(UART_HandleTypeDef *huart)
+{
+	uint8_t i;
+
+	for (i = 0; i < UartCnt; i++)
+	{
+		if (Uart[i].Uart == huart) return i;
+	}
+	memset(&Uart[i], 0, sizeof(Uart[i]));
+	Uart[i].Uart = huart;
+	UartCnt++;
+	return i;
+}
+
+/**
+  * @brief  The function is used to drive a bus from a UART instead of GPIO
+  * @param  B		Simulated bus
+  * @param  huart	UART handle
+  */
+void OneWireSim_AttachUart(OneWireSim_Bus_t *B, UART_HandleTypeDef *huart)
+{
+	Uart[Sim_Uart(huart)].Bus = B;
+	B->Uart = huart;
+}
+
+/**
+  * @brief  The function is used to set the receive DMA buffer of a UART
+  * @param  huart	UART handle
+  * @param  Rx		Receive buffer
+  */
+void OneWireSim_UartRx(UART_HandleTypeDef *huart, uint8_t *Rx)
+{
+	Uart[Sim_Uart(huart)].Rx = Rx;
+}
+
+/**
+  * @brief  The function is used to start a UART DMA transmission
+  * @param  huart	UART handle
+  * @param  Tx		Transmit buffer
+  * @param  Len		Number of byte
+  */
+void OneWireSim_UartTx(UART_HandleTypeDef *huart, const uint8_t *Tx,
+		uint16_t Len)
+{
+	uint8_t i = Sim_Uart(huart);
+
+	OneWireSim_Sync();
+	Uart[i].Tx = Tx;
+	Uart[i].Len = Len;
+	Uart[i].Pos = 0;
+	Uart[i].Start = Now;
+	Uart[i].Half = SystemCoreClock / (2U * huart->Init.BaudRate);
+	Uart[i].Cplt = (Uart[i].Bus != NULL);
+	Uart[i].Error = 0;
+	if (!Uart[i].Bus) Uart[i].Len = 0;
+}
+
+/**
+  * @brief  The function is used to abort a UART DMA transfer, the line is
+  * 		released
+  * @param  huart	UART handle
+  */
+void OneWireSim_UartAbort(UART_HandleTypeDef *huart)
+{
+	uint8_t i = Sim_Uart(huart);
+
+	OneWireSim_Sync();
+	Uart[i].Len = 0;
+	Uart[i].Cplt = 0;
+	if (Uart[i].Bus) Bus_Edge(Uart[i].Bus, 0, Now);
+}
+
+/**
+  * @brief  Backs __disable_irq
+  */
+void Sim_DisableIrq(void)
+{
+	IrqMasked = 1;
+}
+
+/**
+  * @brief  Backs __enable_irq, pending interrupts run immediately
+  */
+void Sim_EnableIrq(void)
+{
+	IrqMasked = 0;
+	Sim_RunIrq(Now);
+}
+
+/**
+  * @brief  Backs __get_PRIMASK
+  * @retval Interrupts masked = 1
+  */
+uint32_t Sim_GetPrimask(void)
+{
+	return IrqMasked;
+}
+
+/**
+  * @brief  Backs __WFI, sleeps until the next interrupt is pending
+  */
+void Sim_Wfi(void)
+{
+	uint64_t at, start = Now;
+
+	/* Changes made before sleeping happened at the current time */
+	Sim_Enter();
+	OneWireSim_Sync();
+	if (Sim_NextIrq(&at) < 0)
+	{
+		at = Now + SystemCoreClock / 1000000U;
+	}
+	Sim_RunUart(at);
+	if (at > Now) Now = at;
+	OneWireSim_Stat.IdleCycles += Now - start;
+	OneWireSim_Sync();
+	Sim_RunIrq(Now);
+	Sim_Leave();
+}
+
+/**
+  * @brief  Backs __HAL_TIM_GET_COUNTER
+  * @retval Counter of the 1 MHz timers
+  */
+uint32_t Sim_TimCounter(void)
+{
+	return (uint32_t)(Now / (SystemCoreClock / 1000000U)) & 0xFFFFU;
+}
+
+/**
+  * @brief  The function is used to get the simulated clock
+  * @retval Core cycles since OneWireSim_Reset
+  */
+uint64_t OneWireSim_Now(void)
+{
+	return Now;
+}
+
+/**
+  * @brief  The function is used to convert cycles to microsecond
+  * @retval Time in microsecond
+  * @param  Cycles	Number of core cycles
+  */
+double OneWireSim_ToUs(uint64_t Cycles)
+{
+	return (double)Cycles / (SystemCoreClock / 1000000U);
+}
+
+/**
+  * @brief  The function is used to set a device die temperature
+  * @param  Dev		Simulated device
+  * @param  Temp	Temperature in deg C
+  */
+void OneWireSim_SetTemp(OneWireSim_Dev_t *Dev, float Temp)
+{
+	Dev->Temp = (int16_t)(Temp * 16.0f);
+}
+
+/**
+  * @brief  The function is used to give a device another family code, it
+  * 		still answers as a DS18B20
+  * @param  Dev		Simulated device
+  * @param  Family	Family code
+  */
+void OneWireSim_SetFamily(OneWireSim_Dev_t *Dev, uint8_t Family)
+{
+	Dev->Rom[0] = Family;
+	Dev->Rom[7] = Sim_CRC8(Dev->Rom, 7);
+}
+
+/**
+  * @brief  The function is used to power a device from the line, it needs
+  * 		the strong pull-up while converting and copying
+  * @param  B		Simulated bus
+  * @param  Idx		Device index on the bus
+  */
+void OneWireSim_SetParasite(OneWireSim_Bus_t *B, uint16_t Idx)
+{
+	B->Dev[Idx].Parasite = 1;
+	B->Parasite = 1;
+	HostTimed = 1;
+}
+
+/**
+  * @brief  The function is used to add a bus with virtual DS18B20
+  * @retval Simulated bus, NULL if too many buses
+  * @param  Port	GPIO port of the bus
+  * @param  Pin		GPIO pin of the bus
+  * @param  DevCnt	Number of devices on the bus
+  * @param  Seed	Seed for the ROM serial numbers
+  */
+OneWireSim_Bus_t *OneWireSim_AddBus(GPIO_TypeDef *Port, uint16_t Pin,
+		uint16_t DevCnt, uint32_t Seed)
+{
+	OneWireSim_Bus_t *B;
+
+	if (BusCnt >= ONEWIRE_SIM_MAX_BUS) return NULL;
+	B = &Bus[BusCnt++];
+	memset(B, 0, sizeof(*B));
+	B->Port = Port;
+	B->Pin = Pin;
+	PortUsed |= 1U << (Port - SimGPIO);
+	B->DevCnt = DevCnt;
+	B->Dev = calloc(DevCnt ? DevCnt : 1, sizeof(OneWireSim_Dev_t));
+
+	for (uint16_t i = 0; i < DevCnt; i++)
+	{
+		OneWireSim_Dev_t *Dev = &B->Dev[i];
+
+		/* Family code, 48 bit serial, CRC */
+		Dev->Rom[0] = 0x28;
+		for (uint8_t j = 1; j < 7; j++)
+		{
+			Seed = Seed * 1103515245U + 12345U;
+			Dev->Rom[j] = (uint8_t)(Seed >> 16);
+		}
+		Dev->Rom[7] = Sim_CRC8(Dev->Rom, 7);
+
+		/* Factory EEPROM: TH 125, TL -55, 12 bit */
+		Dev->Eeprom[0] = 125;
+		Dev->Eeprom[1] = (uint8_t)-55;
+		Dev->Eeprom[2] = 0x7F;
+
+		/* Power-on scratchpad reads 85 deg C */
+		Dev->Scratch[0] = 0x50;
+		Dev->Scratch[1] = 0x05;
+		memcpy(&Dev->Scratch[2], Dev->Eeprom, 3);
+		Dev->Scratch[5] = 0xFF;
+		Dev->Scratch[6] = 0x0C;
+		Dev->Scratch[7] = 0x10;
+		Dev->Scratch[8] = Sim_CRC8(Dev->Scratch, 8);
+
+		Dev->Temp = 25 * 16;
+		Dev->ConvPct = 80 + (i % 16);
+	}
+	return B;
+}
+
+/**
+  * @brief  The function is used to remove all buses and restart the clock
+  */
+void OneWireSim_Reset(void)
+{
+	for (uint8_t b = 0; b < BusCnt; b++)
+	{
+		free(Bus[b].Dev);
+	}
+	BusCnt = 0;
+	PortUsed = 0;
+	IrqCnt = 0;
+	UartCnt = 0;
+	IrqMasked = 0;
+	Now = 0;
+	HostTimed = 0;
+	HostDepth = 0;
+	HostSim = 0;
+	memset(&OneWireSim_Stat, 0, sizeof(OneWireSim_Stat));
+	memset(SimGPIO, 0, sizeof(GPIO_TypeDef) * SIM_GPIO_PORTS);
+}
+
+/**
+  * @brief  The function backs DWT_CYCCNT, every read costs CyccntCost cycles
+  * @retval Pointer to the counter, writes are kept as offset
+  */
+volatile uint32_t *Sim_Cyccnt(void)
+{
+	static volatile uint32_t cyccnt;
+	static uint32_t last, offset;
+
+	/* Counter was written since the last access */
+	if (cyccnt != last)
+	{
+		offset += cyccnt - last;
+	}
+
+	OneWireSim_Advance(OneWireSim_Cfg.CyccntCost);
+	if (HostTimed) HostCyc = Sim_DriverNs();
+	cyccnt = (uint32_t)Now + offset;
+	last = cyccnt;
+
+	return &cyccnt;
+}
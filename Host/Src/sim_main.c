@@ -0,0 +1,1582 @@
+/**
+  ******************************************************************************
+  * @file    sim_main.c
+  * @brief   Host profiler for the OneWire/DS18B20 driver. Runs the driver
+  * 		 against simulated buses and reports bus time per call
+  ******************************************************************************
+  * @attention
+  * Usage:
+  *		owsim [-b hal|ll|od|it|uart|port] [device count ...]	default hal 2 20 200
+  *
+  *		port runs 16 buses of device count each on GPIOC, read in parallel
+  *
+  *		owsim -c	CRC8 benchmark, table against the bitwise version
+  *
+  *		owsim -l [channels] [hours] [image]	flash log benchmark, 1 s per
+  *					channel, the last run written to image
+  *		owsim -d image [block size]	decode a log image to CSV
+  *
+  ******************************************************************************
+  */
+#include "main.h"
+#include "onewire_sim.h"
+#include "onewire.h"
+#include "ds18b20.h"
+#include "ds18b20_acq.h"
+#include "ds18b20_cache.h"
+#include "ds18b20_ring.h"
+#include "ds18b20_snap.h"
+#include "ds18b20_log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static DS18B20_Drv_t DS;
+static DS18B20_POOL(DS_Pool, DS18B20_POOL_DEFAULT);
+static uint32_t CacheImage[DS18B20_CACHE_SIZE(DS18B20_POOL_DEFAULT) / 4 + 1];
+static OneWire_t OW;
+static DS18B20_Ring_t Rings[DS18B20_POOL_DEFAULT + 2];
+static DS18B20_POOL(Plug_Pool, DS18B20_POOL_DEFAULT + 2);	/* Full bus plus 2 plugged */
+static DS18B20_Snap_t Snap;
+static DS18B20_SNAP_POOL(Snap_Pool, DS18B20_POOL_DEFAULT);
+static volatile uint8_t SnapStop;
+static uint32_t SnapReads, SnapMixed, SnapBack, DirectReads, DirectMixed;
+static DS18B20_Acq_t Acq;
+static DS18B20_Drv_t PortDS[ONEWIRE_PORT_LINES];
+static uint64_t PortPool[ONEWIRE_PORT_LINES][DS18B20_POOL_WORDS(DS18B20_POOL_DEFAULT)];
+static OneWire_t PortOW[ONEWIRE_PORT_LINES];
+static OneWire_Port_t Port;
+static OneWire_IT_t OW_IT;
+static OneWire_UART_t OW_UART;
+static TIM_HandleTypeDef htim2 = { .Instance = TIM2 };
+static TIM_HandleTypeDef htim3 = { .Instance = TIM3 };
+static UART_HandleTypeDef huart2 = { .Instance = USART2 };
+static UART_HandleTypeDef huart3 = { .Instance = USART3 };	/* No bus */
+static const char *Driver = "hal";
+static uint64_t StartAt, StartIdle;
+static uint16_t Added, Removed;
+static uint32_t RingSamples, RingBatches, RingDisorder;
+static uint16_t Failed;
+#ifdef ONEWIRE_PROFILE
+static OneWire_Prof_t Prof;
+#endif
+
+/* Foreign interrupt load, e.g. a motor control loop */
+#define SIM_LOAD_PERIOD		157		/* Period in us */
+#define SIM_LOAD_LEN		20		/* Handler time in us */
+
+/* Longest hot-plug run in ms */
+#define SIM_PLUG_MAX		60000U
+
+/**
+  * @brief  Output Compare callback, forwards to the bit engine
+  * @param  htim	TIM handle
+  */
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+	if (htim == OW_IT.Tim) OneWire_IT_IRQHandler(&OW);
+	if (htim == &htim3)
+	{
+		/* Next period, then the handler runs for its time */
+		htim3.Instance->CCR[0] += SIM_LOAD_PERIOD;
+		OneWireSim_Advance((SystemCoreClock / 1000000U) * SIM_LOAD_LEN);
+	}
+}
+
+/**
+  * @brief  Rx Transfer completed callback, forwards to the UART driver
+  * @param  huart	UART handle
+  */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if (huart == OW_UART.Uart) OneWire_UART_RxCpltCallback(&OW);
+}
+
+/**
+  * @brief  UART error callback, forwards to the UART driver
+  * @param  huart	UART handle
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	if (huart == OW_UART.Uart) OneWire_UART_ErrorCallback(&OW);
+}
+
+/**
+  * @brief  Device found by discovery, counted
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		ROM number of the device
+  */
+void DS18B20_Acq_AddedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM)
+{
+	(void)DS;
+	(void)OW;
+	(void)ROM;
+	Added++;
+}
+
+/**
+  * @brief  Device missing from a discovery pass, counted
+  * @param  DS		DS18B20 HandleTypedef
+  * @param  OW		OneWire HandleTypedef
+  * @param  ROM		ROM number of the device
+  */
+void DS18B20_Acq_RemovedCallback(DS18B20_Drv_t *DS, OneWire_t *OW,
+		const uint8_t *ROM)
+{
+	(void)DS;
+	(void)OW;
+	(void)ROM;
+	Removed++;
+}
+
+/**
+  * @brief  The internal function is used to start a measurement
+  */
+static void Sim_Start(void)
+{
+	StartAt = OneWireSim_Now();
+	StartIdle = OneWireSim_Stat.IdleCycles;
+}
+
+/**
+  * @brief  The internal function is used to print one result line since
+  * 		Sim_Start, CPU time excludes the time spent in WFI
+  * @param  Dev		Number of devices on the bus
+  * @param  Name	Profiled call
+  * @param  Calls	Number of calls
+  * @param  B		Simulated bus
+  */
+static void Sim_Report(uint16_t Dev, const char *Name, uint32_t Calls,
+		OneWireSim_Bus_t *B)
+{
+	uint64_t cycles = OneWireSim_Now() - StartAt;
+	double us = OneWireSim_ToUs(cycles);
+	double cpu = OneWireSim_ToUs(cycles -
+			(OneWireSim_Stat.IdleCycles - StartIdle));
+
+	printf("%7u  %-22s %6u %14.1f %12.1f %14.1f %8u %10u\n", Dev, Name, Calls,
+			us, Calls ? us / Calls : 0.0, cpu, B->Resets, B->Slots);
+	B->Resets = 0;
+	B->Slots = 0;
+}
+
+/**
+  * @brief  The internal function is used to run the acquisition engine on
+  * 		the bus for a while and print its statistics
+  * @param  DevCnt	Number of devices on the bus
+  * @param  Groups	Number of device groups
+  * @param  Period	Target sample period in millisecond
+  */
+static void Sim_Acq(uint16_t DevCnt, uint8_t Groups, uint32_t Period)
+{
+	DS18B20_AcqStats_t st;
+	uint32_t tickstart;
+
+	DS18B20_Acq_Init(&Acq, Period);
+	DS18B20_Acq_AddBus(&Acq, &DS, &OW, Groups);
+
+	tickstart = HAL_GetTick();
+	while ((HAL_GetTick() - tickstart) < 10000U)
+	{
+		if (!DS18B20_Acq_Process(&Acq)) HAL_Delay(1);
+	}
+
+	DS18B20_Acq_GetStats(&Acq, &st);
+	printf("%7u  Acq %u group(s), period %4u ms: %7.2f samples/s, bus %5.1f%%,"
+			" %u errors, %u timeouts\n", DevCnt, Groups, Period, st.Rate,
+			st.Util[0] * 100.0f, st.Errors, st.Timeouts);
+}
+
+/**
+  * @brief  The internal function is used to profile DS18B20_TryRead of all
+  * 		devices under an integrity policy, 2 x VerifyEvery conversions
+  * 		each. The first read is full, then Periodic is full again at
+  * 		read VerifyEvery + 1 and Short is not
+  * @retval Number of reads OK
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  * @param  Verify	Integrity policy
+  * @param  Name	Profiled call
+  */
+static uint16_t Sim_TryRead(uint16_t DevCnt, OneWireSim_Bus_t *B,
+		DS18B20_Verify_t Verify, const char *Name)
+{
+	HAL_StatusTypeDef st;
+	uint64_t cycles = 0, idle = 0;
+	uint16_t ok = 0, wrong = 0;
+	uint8_t full, expect;
+
+	DS.Verify = Verify;
+	DS.VerifyEvery = 4;
+	DS.Mismatch = 0;
+	memset(DS.VerifyCnt, 0, DS.Cnt);
+	B->Resets = 0;
+	B->Slots = 0;
+
+	for (uint8_t n = 0; n < 2 * DS.VerifyEvery; n++)
+	{
+		DS18B20_StartAll(&DS, &OW);
+		HAL_Delay(DS18B20_ConvTime(DS.Resolution));
+
+		/* Only the reads are counted */
+		expect = (Verify == DS18B20_Verify_Full) || (n == 0) ||
+				(Verify == DS18B20_Verify_Periodic && n == DS.VerifyEvery);
+		Sim_Start();
+		for (uint16_t i = 0; i < DS.Cnt; i++)
+		{
+			full = (Verify == DS18B20_Verify_Full) || (DS.VerifyCnt[i] == 0);
+			while ((st = DS18B20_TryRead(&DS, &OW, i, 100)) == HAL_BUSY)
+			{
+				HAL_Delay(1);
+			}
+			ok += (st == HAL_OK);
+			wrong += (full != expect);
+		}
+		cycles += OneWireSim_Now() - StartAt;
+		idle += OneWireSim_Stat.IdleCycles - StartIdle;
+	}
+
+	printf("%7u  %-22s %6u %14.1f %12.1f %14.1f %8u %10u\n", DevCnt, Name,
+			2 * DS.VerifyEvery * DS.Cnt, OneWireSim_ToUs(cycles),
+			OneWireSim_ToUs(cycles) / (2 * DS.VerifyEvery * DS.Cnt),
+			OneWireSim_ToUs(cycles - idle), B->Resets, B->Slots);
+	if (wrong)
+	{
+		printf("FAILED: %u reads against the full read schedule\n", wrong);
+		Failed++;
+	}
+	B->Resets = 0;
+	B->Slots = 0;
+	return ok;
+}
+
+/**
+  * @brief  The internal function is used to read a device unplugged from a
+  * 		shared bus under DS18B20_Verify_Short, the other devices still
+  * 		answer the reset. The read must fail
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  */
+static void Sim_Unplugged(uint16_t DevCnt, OneWireSim_Bus_t *B)
+{
+	HAL_StatusTypeDef st;
+	uint32_t mismatch;
+	int32_t idx;
+
+	if (DevCnt < 2) return;
+
+	/* Last device of the line, registered with a short read due */
+	idx = DS18B20_Find(&DS, B->Dev[DevCnt - 1].Rom);
+	if (idx < 0) return;
+	DS.Verify = DS18B20_Verify_Short;
+	DS.VerifyCnt[idx] = 1;
+	mismatch = DS.Mismatch;
+
+	B->DevCnt = DevCnt - 1;
+	DS18B20_StartAll(&DS, &OW);
+	HAL_Delay(DS18B20_ConvTime(DS.Resolution));
+	while ((st = DS18B20_TryRead(&DS, &OW, idx, 0)) == HAL_BUSY)
+	{
+		HAL_Delay(1);
+	}
+	B->DevCnt = DevCnt;
+
+	printf("%7u  Short read unplugged: %s, %u mismatch, next read %s\n",
+			DevCnt, (st == HAL_OK) ? "HAL_OK" : "HAL_TIMEOUT",
+			DS.Mismatch - mismatch, DS.VerifyCnt[idx] ? "short" : "full");
+	if (st == HAL_OK || DS.VerifyCnt[idx] != 0)
+	{
+		printf("FAILED: unplugged device read as valid\n");
+		Failed++;
+	}
+	DS.Verify = DS18B20_Verify_Full;
+}
+
+/**
+  * @brief  The internal function is used to check the UART driver on a
+  * 		line shorted to ground and on a UART without echo, both must
+  * 		fail within their timeout instead of hanging
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  */
+static void Sim_UartFault(uint16_t DevCnt, OneWireSim_Bus_t *B)
+{
+	static OneWire_UART_t u;
+	OneWire_t ow = { 0 };
+	uint32_t errors = OW_UART.Errors;
+	uint8_t data[9], reset, echo;
+	HAL_StatusTypeDef st;
+	uint64_t t0;
+	double ms;
+
+	/* Framing error, the stop bit reads low */
+	B->Short = 1;
+	t0 = OneWireSim_Now();
+	reset = OneWire_Reset(&OW);
+	st = OneWire_UART_Xfer(&OW, NULL, 0, data, 72);
+	ms = OneWireSim_ToUs(OneWireSim_Now() - t0) / 1000.0;
+	B->Short = 0;
+
+	/* Nothing received, the transfer times out */
+	OneWire_UART_Init(&ow, &u, &huart3);
+	echo = OneWire_UART_Reset(&ow);
+
+	printf("%7u  UART line shorted: %s, Xfer %s after %.1f ms, %u errors;"
+			" no echo: %s, %u errors\n", DevCnt,
+			reset ? "no presence" : "presence",
+			(st == HAL_OK) ? "HAL_OK" : "HAL_ERROR", ms,
+			OW_UART.Errors - errors, echo ? "no presence" : "presence",
+			u.Errors);
+	if (!reset || st == HAL_OK || !echo || u.Errors != 1)
+	{
+		printf("FAILED: UART fault not reported\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to short the UART line for a
+  * 		moment in the scratchpad bytes of a read. The read must fail
+  * 		with nothing sent before the next reset, then read again
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  */
+static void Sim_UartMidRead(uint16_t DevCnt, OneWireSim_Bus_t *B)
+{
+	uint8_t data[9], ok, again;
+
+	/* Match ROM and command are 80 slots, short in the third byte read */
+	B->FaultSlots = 0;
+	B->ShortSlot = B->Slots + 100;
+	ok = DS18B20_ReadScratchpad(&OW, DS18B20_ROM(&DS, 0), data, 9);
+	B->ShortSlot = 0;
+	again = DS18B20_ReadScratchpad(&OW, DS18B20_ROM(&DS, 0), data, 9);
+
+	printf("%7u  UART fault mid-scratchpad: read %s, %u slots sent before"
+			" the reset, read again %s\n", DevCnt, ok ? "ok" : "failed",
+			B->FaultSlots, again ? "ok" : "failed");
+	if (ok || B->FaultSlots || !again)
+	{
+		printf("FAILED: failed transfer replayed on the addressed bus\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to reset an emptied bus while a
+  * 		background transfer of the bit engine runs, the reset must
+  * 		report its own presence, not the earlier one
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  */
+static void Sim_ItBusy(uint16_t DevCnt, OneWireSim_Bus_t *B)
+{
+	static const uint8_t tx[2] = { 0xFF, 0xFF };
+	uint8_t first, reset;
+
+	first = OneWire_Reset(&OW);
+	B->DevCnt = 0;
+	OneWire_IT_Xfer(&OW, 0, tx, 16, NULL, 0);
+	reset = OneWire_Reset(&OW);
+	OneWire_IT_Wait(&OW);
+	B->DevCnt = DevCnt;
+
+	printf("%7u  Reset behind a running transfer, bus emptied: %s\n",
+			DevCnt, reset ? "no presence" : "presence");
+	if (first || !reset)
+	{
+		printf("FAILED: reset reported an earlier presence\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to read a device at 12 bits on a
+  * 		bus set to 9 bits, its deadline must follow its own resolution
+  * @param  DevCnt	Number of devices on the bus
+  * @param  B		Simulated bus
+  */
+static void Sim_MixedRes(uint16_t DevCnt, OneWireSim_Bus_t *B)
+{
+	DS18B20_Res_t res = DS.Resolution;
+	HAL_StatusTypeDef st;
+	uint32_t tickstart, t;
+	int32_t idx;
+	float temp;
+
+	idx = DS18B20_Find(&DS, B->Dev[0].Rom);
+	if (idx < 0) return;
+	DS18B20_SetResolution(&DS, &OW, idx, DS18B20_Resolution_12bits);
+	DS.Resolution = DS18B20_Resolution_9bits;
+	OneWireSim_SetTemp(&B->Dev[0], 42.5f);
+
+	tickstart = HAL_GetTick();
+	DS18B20_Start(&DS, &OW, DS18B20_ROM(&DS, idx));
+	while ((st = DS18B20_TryRead(&DS, &OW, idx, 100)) == HAL_BUSY)
+	{
+		HAL_Delay(1);
+	}
+	t = HAL_GetTick() - tickstart;
+	temp = DS18B20_TEMP_FLOAT(DS.Temperature[idx]);
+	DS.Resolution = res;
+
+	printf("%7u  12 bit device on 9 bit bus: %s after %u ms, %.4f deg\n",
+			DevCnt, (st == HAL_OK) ? "HAL_OK" : "HAL_TIMEOUT", t,
+			(double)temp);
+	if (st != HAL_OK || temp != 42.5f)
+	{
+		printf("FAILED: read before the conversion was done\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to profile the family search,
+  * 		the single device verify and the cache search boot on a mixed
+  * 		bus, one DS18B20 in four
+  * @param  DevCnt	Number of devices on the bus
+  */
+static void Sim_Family(uint16_t DevCnt)
+{
+	static const uint8_t family[4] = { DS18B20_FAMILY_CODE, 0x10, 0x3A, 0x01 };
+	OneWireSim_Bus_t *B;
+	uint8_t rom[8] = { 0 };
+	uint8_t hit;
+	uint16_t n;
+
+	OneWireSim_Reset();
+	B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt, 0x5678U + DevCnt);
+	for (uint16_t i = 0; i < DevCnt; i++)
+	{
+		OneWireSim_SetFamily(&B->Dev[i], family[i % 4]);
+	}
+
+	memset(&OW, 0, sizeof(OW));
+	DwtInit();
+	OW.DataPin = DS_Pin;
+	OW.DataPort = DS_GPIO_Port;
+	OneWire_Init(&OW);
+	B->Resets = 0;
+	B->Slots = 0;
+
+	Sim_Start();
+	for (n = 0; OneWire_Search(&OW, ONEWIRE_CMD_SEARCHROM); n++) {}
+	Sim_Report(DevCnt, "OneWire_Search all", n, B);
+
+	Sim_Start();
+	OneWire_TargetSetup(&OW, DS18B20_FAMILY_CODE);
+	for (n = 0; OneWire_Search(&OW, ONEWIRE_CMD_SEARCHROM) &&
+			OW.RomByte[0] == DS18B20_FAMILY_CODE; n++)
+	{
+		OneWire_GetDevRom(&OW, rom);
+	}
+	OneWire_ResetSearch(&OW);
+	Sim_Report(DevCnt, "OneWire_Search 0x28", n, B);
+
+	Sim_Start();
+	n = OneWire_Verify(&OW, rom);
+	Sim_Report(DevCnt, "OneWire_Verify", 1, B);
+	printf("%7u  mixed bus, last DS18B20 %s\n", DevCnt,
+			n ? "present" : "missing");
+
+	/* Cache search boot registers and configures DS18B20 only */
+	memset(&DS, 0, sizeof(DS));
+	DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+	DS.Resolution = DS18B20_Resolution_12bits;
+	DS18B20_Init(&DS, &OW);
+	DS18B20_Cache_Store(&DS, &OW, CacheImage, sizeof(CacheImage));
+	Sim_Start();
+	hit = DS18B20_Cache_Boot(&DS, &OW, CacheImage, sizeof(CacheImage),
+			DS18B20_Cache_Search);
+	Sim_Report(DevCnt, "Cache_Boot search 0x28", 1, B);
+	for (n = 0; n < DS.Cnt && (DS.Status[n] & DS18B20_STAT_CONFIG) &&
+			DS18B20_ROM(&DS, n)[0] == DS18B20_FAMILY_CODE; n++) {}
+
+	printf("%7u  mixed bus cache search: %s, %u of %u DS18B20, %u"
+			" configured\n\n", DevCnt, hit ? "hit" : "miss", DS.Cnt,
+			(DevCnt + 3) / 4, n);
+	if (!hit || DS.Cnt != (DevCnt + 3) / 4 || n != DS.Cnt)
+	{
+		printf("FAILED: cache search registered other families\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to time a whole sample, start to
+  * 		last read, on an externally powered and on a parasite powered
+  * 		bus, then on the parasite bus without strong pull-up
+  * @param  DevCnt	Number of devices on the bus
+  */
+static void Sim_Power(uint16_t DevCnt)
+{
+	static const char *name[3] = { "Sample external", "Sample parasite",
+			"Sample no pull-up" };
+	OneWireSim_Bus_t *B;
+	HAL_StatusTypeDef st;
+	uint16_t ok, hot;
+
+	for (uint8_t m = 0; m < 3; m++)
+	{
+		OneWireSim_Reset();
+		B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt, 0xDEF0U + DevCnt);
+		for (uint16_t i = 0; m && i < DevCnt; i++)
+		{
+			OneWireSim_SetParasite(B, i);
+		}
+
+		memset(&DS, 0, sizeof(DS));
+		memset(&OW, 0, sizeof(OW));
+		DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+		DwtInit();
+		OW.DataPin = DS_Pin;
+		OW.DataPort = DS_GPIO_Port;
+		DS.Resolution = DS18B20_Resolution_12bits;
+		DS18B20_Init(&DS, &OW);
+
+		/* Driver unaware of the parasite supply */
+		if (m == 2) DS.Parasite = 0;
+
+		ok = 0;
+		hot = 0;
+		Sim_Start();
+		DS18B20_StartAll(&DS, &OW);
+		for (uint16_t i = 0; i < DS.Cnt; i++)
+		{
+			while ((st = DS18B20_TryRead(&DS, &OW, i, 100)) == HAL_BUSY)
+			{
+				HAL_Delay(1);
+			}
+			ok += (st == HAL_OK);
+			hot += (DS18B20_TEMP_FLOAT(DS.Temperature[i]) == 85.0f);
+		}
+		Sim_Report(DevCnt, name[m], 1, B);
+		printf("%7u  %s bus, %s wait: %u read, %u at power-on 85 deg,"
+				" %lu brownouts\n", DevCnt, B->Parasite ? "parasite" : "external",
+				DS.Parasite ? "strong pull-up" : "polling", ok, hot,
+				(unsigned long)B->Brownouts);
+
+		/* The driver must not compute deadlines first, the simulated
+		 * time stands still while it does */
+		if (m != 1) continue;
+		if (DS.Cnt) DS18B20_Start(&DS, &OW, DS18B20_ROM(&DS, DS.Cnt - 1));
+		printf("%7u  Strong pull-up %.2f us bus time, %.2f us host time after"
+				" the command, %lu after a tick read\n", DevCnt,
+				OneWireSim_ToUs(B->SpuBus), B->SpuHostNs / 1000.0,
+				(unsigned long)B->SpuLate);
+		if (OneWireSim_ToUs(B->SpuBus) > ONEWIRE_SIM_SPU_WAIT || B->SpuLate)
+		{
+			printf("FAILED: strong pull-up later than %u us or after the"
+					" deadlines\n", ONEWIRE_SIM_SPU_WAIT);
+			Failed++;
+		}
+	}
+	printf("\n");
+}
+
+/**
+  * @brief  The internal function is used to enumerate and read the bus while
+  * 		a foreign interrupt takes SIM_LOAD_LEN every SIM_LOAD_PERIOD,
+  * 		for the bit-bang drivers
+  * @param  DevCnt	Number of devices on the bus
+  */
+static void Sim_IrqLoad(uint16_t DevCnt)
+{
+	OneWireSim_Bus_t *B;
+	uint16_t ok = 0;
+	int16_t raw;
+
+	if (strcmp(Driver, "hal") && strcmp(Driver, "ll") && strcmp(Driver, "od"))
+	{
+		return;
+	}
+
+	OneWireSim_Reset();
+	B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt, 0x5A5AU + DevCnt);
+
+	memset(&DS, 0, sizeof(DS));
+	memset(&OW, 0, sizeof(OW));
+	DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+	DwtInit();
+	OW.DataPin = DS_Pin;
+	OW.DataPort = DS_GPIO_Port;
+	DS.Resolution = DS18B20_Resolution_12bits;
+	if (!strcmp(Driver, "ll"))
+	{
+		OW.Ops = &OneWire_LL_Ops;
+	} else if (!strcmp(Driver, "od")) {
+		OneWire_OD_Init(&OW);
+	}
+
+	htim3.Instance->CCR[0] = SIM_LOAD_PERIOD;
+	HAL_TIM_OC_Start_IT(&htim3, TIM_CHANNEL_1);
+
+	Sim_Start();
+	DS18B20_Init(&DS, &OW);
+	DS18B20_StartAll(&DS, &OW);
+	for (uint16_t i = 0; i < DS.Cnt; i++)
+	{
+		ok += DS18B20_ReadRaw(&OW, DS18B20_ROM(&DS, i), &raw);
+	}
+	Sim_Report(DevCnt, "Init + Read, IRQ load", 1, B);
+
+	HAL_TIM_OC_Stop_IT(&htim3, TIM_CHANNEL_1);
+	printf("%7u  %u us IRQ every %u us: found %u, read %u ok, masked max"
+			" %.1f us, %lu overruns, IRQ latency max %.1f us, %lu IRQs\n\n",
+			DevCnt, SIM_LOAD_LEN, SIM_LOAD_PERIOD, DS.Cnt, ok,
+			OneWireSim_ToUs(OW.Timing.MaskMax), (unsigned long)OW.Timing.Overruns,
+			OneWireSim_ToUs(OneWireSim_Stat.IrqLatencyMax),
+			(unsigned long)OneWireSim_Stat.Irqs);
+}
+
+/**
+  * @brief  The internal function is used to read the snapshot and the
+  * 		registry in a loop from another thread. Every device of a cycle
+  * 		holds the same temperature, a mix of two cycles is counted
+  * @retval NULL
+  * @param  Arg		Unused
+  */
+static void *Sim_SnapReader(void *Arg)
+{
+	static DS18B20_SnapDev_t dev[DS18B20_POOL_DEFAULT];
+	volatile DS18B20_Temp_t *temp = DS.Temperature;
+	DS18B20_Temp_t first;
+	uint32_t cycle, last = 0;
+	uint16_t cnt;
+
+	(void)Arg;
+	while (!SnapStop)
+	{
+		cnt = DS18B20_Snap_Read(&Snap, dev, DS18B20_POOL_DEFAULT, &cycle);
+		if (cnt)
+		{
+			SnapReads++;
+			if (cycle < last) SnapBack++;
+			last = cycle;
+			for (uint16_t i = 1; i < cnt; i++)
+			{
+				if (dev[i].Temperature != dev[0].Temperature)
+				{
+					SnapMixed++;
+					break;
+				}
+			}
+		}
+
+		/* Same check on the registry written in place */
+		cnt = DS.Cnt;
+		first = temp[0];
+		DirectReads++;
+		for (uint16_t i = 1; i < cnt; i++)
+		{
+			if (temp[i] != first)
+			{
+				DirectMixed++;
+				break;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+  * @brief  The internal function is used to run the acquisition engine with
+  * 		a snapshot read by another thread, the temperature of all
+  * 		devices changes between cycles
+  * @param  DevCnt	Number of devices on the bus
+  */
+static void Sim_Snapshot(uint16_t DevCnt)
+{
+	OneWireSim_Bus_t *B;
+	pthread_t reader;
+	uint32_t tickstart;
+
+	OneWireSim_Reset();
+	B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt, 0x3C3CU + DevCnt);
+
+	memset(&DS, 0, sizeof(DS));
+	memset(&OW, 0, sizeof(OW));
+	DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+	DwtInit();
+	OW.DataPin = DS_Pin;
+	OW.DataPort = DS_GPIO_Port;
+	DS.Resolution = DS18B20_Resolution_9bits;
+	DS18B20_Init(&DS, &OW);
+
+	DS18B20_Snap_Init(&Snap, Snap_Pool, DS18B20_POOL_DEFAULT);
+	DS18B20_Acq_Init(&Acq, 0);
+	Acq.AlarmSearch = 0;
+	DS18B20_Acq_AddBus(&Acq, &DS, &OW, 1);
+	DS18B20_Acq_SetSnapshot(&Acq, &DS, &Snap);
+
+	SnapStop = 0;
+	SnapReads = SnapMixed = SnapBack = DirectReads = DirectMixed = 0;
+	pthread_create(&reader, NULL, Sim_SnapReader, NULL);
+
+	tickstart = HAL_GetTick();
+	while ((HAL_GetTick() - tickstart) < 10000U)
+	{
+		/* New temperature for the next conversion, all devices alike */
+		if (Acq.Bus[0].Group[0].State == DS18B20_Acq_Idle)
+		{
+			for (uint16_t i = 0; i < B->DevCnt; i++)
+			{
+				OneWireSim_SetTemp(&B->Dev[i], 20.0f + (Snap.Cycle % 16));
+			}
+		}
+		if (!DS18B20_Acq_Process(&Acq)) HAL_Delay(1);
+	}
+
+	SnapStop = 1;
+	pthread_join(reader, NULL);
+	printf("%7u  Snapshot: %u cycles, %u copies, %u mixed, %u out of order;"
+			" Temperature[] in place: %u of %u reads mixed\n\n", DevCnt,
+			Snap.Cycle, SnapReads, SnapMixed, SnapBack, DirectMixed,
+			DirectReads);
+}
+
+/**
+  * @brief  The internal function is used to drain every sample ring in
+  * 		batches of 8, checking the order of the samples per device
+  * @param  Cnt		Number of rings
+  */
+static void Sim_RingConsume(uint16_t Cnt)
+{
+	static uint32_t last[DS18B20_POOL_DEFAULT + 2];
+	static uint64_t owner[DS18B20_POOL_DEFAULT + 2];
+	DS18B20_Sample_t batch[8];
+	uint64_t rom;
+	uint16_t n;
+
+	for (uint16_t i = 0; i < Cnt; i++)
+	{
+		while ((n = DS18B20_Ring_Read(&Rings[i], (uint8_t *)&rom, batch, 8)))
+		{
+			/* Ring given to another device, its stamps start over */
+			if (rom != owner[i]) last[i] = 0;
+			owner[i] = rom;
+
+			for (uint16_t k = 0; k < n; k++)
+			{
+				if (batch[k].Stamp < last[i]) RingDisorder++;
+				last[i] = batch[k].Stamp;
+			}
+			RingSamples += n;
+			RingBatches++;
+		}
+	}
+}
+
+/**
+  * @brief  The internal function is used to drain the sample rings left
+  * 		and print their totals against the engine statistics
+  * @param  DevCnt	Number of devices on the bus
+  * @param  St		Engine statistics
+  */
+static void Sim_RingDrain(uint16_t DevCnt, const DS18B20_AcqStats_t *St)
+{
+	uint32_t dropped = 0;
+
+	Sim_RingConsume(DevCnt + 2);
+	for (uint16_t i = 0; i < DevCnt + 2; i++)
+	{
+		dropped += Rings[i].Dropped;
+	}
+	printf("%7u  Rings: %u of %u reads drained in %u batches, %u dropped,"
+			" %u without ring, %u out of order\n\n", DevCnt, RingSamples,
+			St->Samples + St->Timeouts, RingBatches, dropped, DS.RingMiss,
+			RingDisorder);
+}
+
+/**
+  * @brief  The internal function is used to run the acquisition engine with
+  * 		discovery while devices are plugged and unplugged: 2 more at
+  * 		3 s, 3 less once both are found, the 2 new ones and an old one.
+  * 		Fails unless every change is found within SIM_PLUG_MAX
+  * @param  DevCnt	Number of devices on the bus at start
+  */
+static void Sim_HotPlug(uint16_t DevCnt)
+{
+	OneWireSim_Bus_t *B;
+	DS18B20_AcqStats_t st;
+	uint64_t t0, step, longest = 0;
+	uint32_t tickstart, t, plug = 0, unplug = 0, found = 0, gone = 0;
+
+	OneWireSim_Reset();
+	B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt + 2, 0x9ABCU + DevCnt);
+	B->DevCnt = DevCnt;
+
+	memset(&DS, 0, sizeof(DS));
+	memset(&OW, 0, sizeof(OW));
+	DS18B20_SetPool(&DS, Plug_Pool, sizeof(Plug_Pool));
+	DwtInit();
+	OW.DataPin = DS_Pin;
+	OW.DataPort = DS_GPIO_Port;
+	DS.Resolution = DS18B20_Resolution_12bits;
+	DS18B20_Init(&DS, &OW);
+
+	DS18B20_Ring_Attach(&DS, Rings, DevCnt + 2);
+	RingSamples = 0;
+	RingBatches = 0;
+	RingDisorder = 0;
+
+	DS18B20_Acq_Init(&Acq, 1000);
+	Acq.Discovery = 1000;
+	DS18B20_Acq_AddBus(&Acq, &DS, &OW, 4);
+	Added = 0;
+	Removed = 0;
+
+	tickstart = HAL_GetTick();
+	while ((t = HAL_GetTick() - tickstart) < SIM_PLUG_MAX && Removed < 3)
+	{
+		if (!plug && t >= 3000U)
+		{
+			B->DevCnt = DevCnt + 2;
+			plug = t;
+		}
+		if (plug && !found && Added >= 2) found = t;
+		if (found && !unplug && t >= 6000U)
+		{
+			B->DevCnt = DevCnt - 1;
+			unplug = t;
+		}
+
+		t0 = OneWireSim_Now();
+		if (!DS18B20_Acq_Process(&Acq)) HAL_Delay(1);
+		step = OneWireSim_Now() - t0;
+		if (step > longest) longest = step;
+
+		/* Consumer side, batches every 250 ms */
+		if ((t % 250U) == 0) Sim_RingConsume(DevCnt + 2);
+	}
+	if (unplug && Removed >= 3) gone = t;
+
+	DS18B20_Acq_GetStats(&Acq, &st);
+	printf("%7u  Hot-plug +2 at 3 s found at %.1f s, -3 at %.1f s gone at"
+			" %.1f s: %u added, %u removed, %u left, %.2f samples/s, longest"
+			" step %.1f ms\n", DevCnt, found / 1000.0, unplug / 1000.0,
+			gone / 1000.0, Added, Removed, DS.Cnt, st.Rate,
+			OneWireSim_ToUs(longest) / 1000.0);
+	if (Added != 2 || Removed != 3 || DS.Cnt != DevCnt - 1)
+	{
+		printf("FAILED: discovery missed plug events\n");
+		Failed++;
+	}
+	Sim_RingDrain(DevCnt, &st);
+}
+
+/**
+  * @brief  The internal function is used to profile one bus size
+  * @param  DevCnt	Number of devices on the bus
+  */
+static void Sim_Profile(uint16_t DevCnt)
+{
+	OneWireSim_Bus_t *B;
+	uint16_t ok = 0, tryok = 0;
+	uint8_t hit, cfg;
+	int16_t raw;
+
+	OneWireSim_Reset();
+	B = OneWireSim_AddBus(DS_GPIO_Port, DS_Pin, DevCnt, 0x1234U + DevCnt);
+	for (uint16_t i = 0; i < DevCnt; i++)
+	{
+		/* 20..34 deg C, so device 0 alarm at 31 deg C triggers on some runs */
+		OneWireSim_SetTemp(&B->Dev[i], 20.0f + (float)(i % 15) + 0.0625f * i);
+	}
+
+	memset(&DS, 0, sizeof(DS));
+	memset(&OW, 0, sizeof(OW));
+	DS18B20_SetPool(&DS, DS_Pool, sizeof(DS_Pool));
+	DwtInit();
+	OW.DataPin = DS_Pin;
+	OW.DataPort = DS_GPIO_Port;
+	DS.Resolution = DS18B20_Resolution_12bits;
+	if (!strcmp(Driver, "ll"))
+	{
+		OW.Ops = &OneWire_LL_Ops;
+	} else if (!strcmp(Driver, "od")) {
+		OneWire_OD_Init(&OW);
+	} else if (!strcmp(Driver, "it")) {
+		OneWire_IT_Init(&OW, &OW_IT, &htim2, TIM_CHANNEL_1);
+	} else if (!strcmp(Driver, "uart")) {
+		OneWireSim_AttachUart(B, &huart2);
+		OneWire_UART_Init(&OW, &OW_UART, &huart2);
+	}
+#ifdef ONEWIRE_PROFILE
+	OneWire_Prof_Init(&OW, &Prof);
+#endif
+
+	Sim_Start();
+	DS18B20_Init(&DS, &OW);
+	Sim_Report(DevCnt, "DS18B20_Init", 1, B);
+
+	/* Boot from the ROM cache, then from a corrupted image */
+	DS18B20_Cache_Store(&DS, &OW, CacheImage, sizeof(CacheImage));
+	Sim_Start();
+	hit = DS18B20_Cache_Boot(&DS, &OW, CacheImage, sizeof(CacheImage),
+			DS18B20_Cache_Verify);
+	Sim_Report(DevCnt, "Cache_Boot verify", 1, B);
+
+	Sim_Start();
+	hit += DS18B20_Cache_Boot(&DS, &OW, CacheImage, sizeof(CacheImage),
+			DS18B20_Cache_Search);
+	Sim_Report(DevCnt, "Cache_Boot search", 1, B);
+
+	((uint8_t *)CacheImage)[sizeof(DS18B20_CacheHdr_t)] ^= 0x01;
+	Sim_Start();
+	hit += DS18B20_Cache_Boot(&DS, &OW, CacheImage, sizeof(CacheImage),
+			DS18B20_Cache_Verify);
+	Sim_Report(DevCnt, "Cache_Boot corrupted", 1, B);
+
+	Sim_Start();
+	DS18B20_SetTempAlarm(&DS, &OW, 0, 0, 31);
+	Sim_Report(DevCnt, "DS18B20_SetTempAlarm", 1, B);
+
+	Sim_Start();
+	DS18B20_SetTempAlarm(&DS, &OW, 0, 0, 31);
+	Sim_Report(DevCnt, "SetTempAlarm (same)", 1, B);
+
+	Sim_Start();
+	DS18B20_Commit(&DS, &OW);
+	Sim_Report(DevCnt, "DS18B20_Commit", 1, B);
+
+	/* Same resolution on every device, one by one and broadcast */
+	Sim_Start();
+	for (uint16_t i = 0; i < DS.Cnt; i++)
+	{
+		DS18B20_SetResolution(&DS, &OW, i, DS18B20_Resolution_11bits);
+	}
+	Sim_Report(DevCnt, "DS18B20_SetResolution", DS.Cnt, B);
+
+	Sim_Start();
+	cfg = DS18B20_SetConfigAll(&DS, &OW, DS18B20_Resolution_12bits, 0, 0, 0);
+	Sim_Report(DevCnt, "DS18B20_SetConfigAll", 1, B);
+
+	DS18B20_SetConfigAll(&DS, &OW, DS18B20_Resolution_11bits, 0, 0, 0);
+	Sim_Start();
+	cfg &= DS18B20_SetConfigAll(&DS, &OW, DS18B20_Resolution_12bits, 0, 0, 1);
+	Sim_Report(DevCnt, "SetConfigAll (verify)", 1, B);
+
+	Sim_Start();
+	DS18B20_StartAll(&DS, &OW);
+	Sim_Report(DevCnt, "DS18B20_StartAll", 1, B);
+
+	/* First read includes the wait for the conversion */
+	Sim_Start();
+	ok += DS18B20_ReadRaw(&OW, DS18B20_ROM(&DS, 0), &raw);
+	DS.Temperature[0] = DS18B20_TEMP(raw);
+	Sim_Report(DevCnt, "DS18B20_Read (first)", 1, B);
+
+	Sim_Start();
+	for (uint16_t i = 1; i < DS.Cnt; i++)
+	{
+		ok += DS18B20_ReadRaw(&OW, DS18B20_ROM(&DS, i), &raw);
+		DS.Temperature[i] = DS18B20_TEMP(raw);
+	}
+	Sim_Report(DevCnt, "DS18B20_Read", DS.Cnt - 1, B);
+
+	/* Bus stays idle until the conversion deadline */
+	tryok = Sim_TryRead(DevCnt, B, DS18B20_Verify_Full, "DS18B20_TryRead full");
+	Sim_TryRead(DevCnt, B, DS18B20_Verify_Short, "DS18B20_TryRead short");
+	Sim_TryRead(DevCnt, B, DS18B20_Verify_Periodic, "DS18B20_TryRead 1/4");
+	DS.Verify = DS18B20_Verify_Full;
+	Sim_Unplugged(DevCnt, B);
+	Sim_MixedRes(DevCnt, B);
+	if (!strcmp(Driver, "uart"))
+	{
+		Sim_UartFault(DevCnt, B);
+		Sim_UartMidRead(DevCnt, B);
+	}
+	if (!strcmp(Driver, "it")) Sim_ItBusy(DevCnt, B);
+
+	Sim_Start();
+	DS18B20_AlarmSearch(&DS, &OW);
+	Sim_Report(DevCnt, "DS18B20_AlarmSearch", 1, B);
+
+	Sim_Acq(DevCnt, 1, 0);
+	Sim_Acq(DevCnt, 4, 0);
+	Sim_Acq(DevCnt, 4, 1000);
+
+	printf("%7u  found %u, %u dropped, cache hit %u/2, config %s, read %u ok,"
+			" try read %u ok, T[0] %.4f\n\n", DevCnt, DS.Cnt, DS.Dropped, hit,
+			cfg ? "ok" : "failed", ok, tryok / (2 * DS.VerifyEvery),
+			(double)DS18B20_TEMP_FLOAT(DS.Temperature[0]));
+#ifdef ONEWIRE_PROFILE
+	OneWire_Prof_Dump(&OW, Driver);
+	printf("\n");
+#endif
+
+	Sim_Family(DevCnt);
+	Sim_Power(DevCnt);
+	Sim_IrqLoad(DevCnt);
+	Sim_Snapshot(DevCnt);
+	Sim_HotPlug(DevCnt);
+}
+
+/**
+  * @brief  The internal function is used to profile 16 buses on one port,
+  * 		discovered one by one and read in parallel, then read with a
+  * 		shorted and an empty line
+  * @param  DevCnt	Number of devices per bus
+  */
+static void Sim_ProfilePort(uint16_t DevCnt)
+{
+	OneWireSim_Bus_t *B[ONEWIRE_PORT_LINES];
+	DS18B20_Temp_t temp[ONEWIRE_PORT_LINES];
+	uint8_t rom[ONEWIRE_PORT_LINES][8];
+	uint32_t ok = 0, tickstart;
+	uint16_t fault;
+
+	if (DevCnt > DS18B20_POOL_DEFAULT)
+	{
+		printf("%7u  skipped, DS18B20_POOL_DEFAULT is %u\n", DevCnt, DS18B20_POOL_DEFAULT);
+		return;
+	}
+
+	OneWireSim_Reset();
+	DwtInit();
+	for (uint8_t l = 0; l < ONEWIRE_PORT_LINES; l++)
+	{
+		B[l] = OneWireSim_AddBus(GPIOC, 1U << l, DevCnt, 0x4321U + l);
+		for (uint16_t i = 0; i < DevCnt; i++)
+		{
+			OneWireSim_SetTemp(&B[l]->Dev[i], 20.0f + 0.0625f * (l + i));
+		}
+		memset(&PortDS[l], 0, sizeof(PortDS[l]));
+		memset(&PortOW[l], 0, sizeof(PortOW[l]));
+		DS18B20_SetPool(&PortDS[l], PortPool[l], sizeof(PortPool[l]));
+		PortOW[l].DataPin = 1U << l;
+		PortOW[l].DataPort = GPIOC;
+		PortDS[l].Resolution = DS18B20_Resolution_12bits;
+	}
+
+	Sim_Start();
+	for (uint8_t l = 0; l < ONEWIRE_PORT_LINES; l++)
+	{
+		DS18B20_Init(&PortDS[l], &PortOW[l]);
+	}
+	Sim_Report(DevCnt, "DS18B20_Init x16", ONEWIRE_PORT_LINES, B[0]);
+
+	OneWire_Port_Init(&Port, GPIOC, 0xFFFFU);
+
+	Sim_Start();
+	DS18B20_Port_StartAll(&Port, 0xFFFFU);
+	Sim_Report(DevCnt, "DS18B20_Port_StartAll", 1, B[0]);
+
+	/* First read includes the wait for the conversion */
+	for (uint16_t i = 0; i < DevCnt; i++)
+	{
+		if (i < 2) Sim_Start();
+		for (uint8_t l = 0; l < ONEWIRE_PORT_LINES; l++)
+		{
+			memcpy(rom[l], DS18B20_ROM(&PortDS[l], i), 8);
+		}
+		uint16_t mask = DS18B20_Port_Read(&Port, 0xFFFFU, rom, temp);
+		ok += __builtin_popcount(mask);
+		for (uint8_t l = 0; l < ONEWIRE_PORT_LINES; l++)
+		{
+			PortDS[l].Temperature[i] = temp[l];
+		}
+		if (i == 0) Sim_Report(DevCnt, "DS18B20_Port_Read 1st", 1, B[0]);
+	}
+	if (DevCnt > 1)
+	{
+		Sim_Report(DevCnt, "DS18B20_Port_Read", DevCnt - 1, B[0]);
+	}
+
+	/* Line 3 shorted to ground, line 5 without device */
+	B[3]->Short = 1;
+	B[5]->DevCnt = 0;
+	DS18B20_Port_StartAll(&Port, 0xFFFFU);
+	for (uint8_t l = 0; l < ONEWIRE_PORT_LINES; l++)
+	{
+		memcpy(rom[l], DS18B20_ROM(&PortDS[l], 0), 8);
+	}
+	tickstart = HAL_GetTick();
+	fault = DS18B20_Port_Read(&Port, 0xFFFFU, rom, temp);
+	tickstart = HAL_GetTick() - tickstart;
+	B[3]->Short = 0;
+	B[5]->DevCnt = DevCnt;
+
+	printf("%7u  16 buses, read %u ok, T[15][0] %.4f, masked max %.1f us,"
+			" %lu overruns\n", DevCnt, ok,
+			DS18B20_TEMP_FLOAT(PortDS[15].Temperature[0]),
+			OneWireSim_ToUs(Port.Timing.MaskMax),
+			(unsigned long)Port.Timing.Overruns);
+	printf("%7u  line 3 shorted, line 5 empty: lines 0x%04X read after"
+			" %lu ms\n\n", DevCnt, fault, (unsigned long)tickstart);
+	if (fault != (0xFFFFU & ~0x0028U) ||
+			tickstart > DS18B20_READ_TIMEOUT + 100U)
+	{
+		printf("FAILED: faulty port lines not left out\n");
+		Failed++;
+	}
+}
+
+/**
+  * @brief  The internal function is the bitwise CRC8 the table replaced,
+  * 		kept as reference for the benchmark
+  * @retval CRC of the bytes
+  * @param  Addr	Pointer to address
+  * @param  Len		Number of byte
+  */
+static uint8_t Sim_CRC8_Bitwise(uint8_t *Addr, uint8_t Len)
+{
+	uint8_t crc = 0;
+	uint8_t inbyte, i, mix;
+
+	while (Len--)
+	{
+		inbyte = *Addr++;
+
+		for (i = 8; i; i--)
+		{
+			mix = (crc ^ inbyte) & 0x01;
+			crc >>= 1;
+			crc ^= (mix) ? 0x8C : 0;
+			inbyte >>= 1;
+		}
+	}
+	return crc;
+}
+
+/**
+  * @brief  The internal function is used to get host time
+  * @retval Time in nanosecond
+  */
+static uint64_t Sim_HostNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
+
+/**
+  * @brief  The internal function is used to benchmark CRC8 of scratchpads
+  * 		and ROMs, bitwise against table and streaming per byte
+  */
+static void Sim_BenchCRC(void)
+{
+	enum { N = 4096, LOOPS = 2000 };
+	static uint8_t buf[N][9];
+	volatile uint8_t sink = 0;
+	uint32_t seed = 1, bad = 0;
+	uint64_t t0, t1, t2, t3;
+
+	for (uint32_t i = 0; i < N; i++)
+	{
+		for (uint8_t j = 0; j < 8; j++)
+		{
+			seed = seed * 1103515245U + 12345U;
+			buf[i][j] = (uint8_t)(seed >> 16);
+		}
+		buf[i][8] = Sim_CRC8_Bitwise(buf[i], 8);
+		if (OneWire_CRC8(buf[i], 9) != 0) bad++;
+	}
+
+	t0 = Sim_HostNs();
+	for (uint32_t l = 0; l < LOOPS; l++)
+	{
+		for (uint32_t i = 0; i < N; i++) sink ^= Sim_CRC8_Bitwise(buf[i], 9);
+	}
+	t1 = Sim_HostNs();
+	for (uint32_t l = 0; l < LOOPS; l++)
+	{
+		for (uint32_t i = 0; i < N; i++) sink ^= OneWire_CRC8(buf[i], 9);
+	}
+	t2 = Sim_HostNs();
+	for (uint32_t l = 0; l < LOOPS; l++)
+	{
+		for (uint32_t i = 0; i < N; i++)
+		{
+			uint8_t crc = 0;
+
+			for (uint8_t j = 0; j < 9; j++)
+			{
+				crc = OneWire_CRC8_Update(crc, buf[i][j]);
+			}
+			sink ^= crc;
+		}
+	}
+	t3 = Sim_HostNs();
+
+#ifdef ONEWIRE_CRC_NIBBLE
+	printf("CRC8 9 byte blocks, nibble tables, %u mismatches\n", bad);
+#else
+	printf("CRC8 9 byte blocks, 256 byte table, %u mismatches\n", bad);
+#endif
+	printf("  bitwise   %8.2f ns/block\n", (double)(t1 - t0) / (N * LOOPS));
+	printf("  table     %8.2f ns/block\n", (double)(t2 - t1) / (N * LOOPS));
+	printf("  streaming %8.2f ns/block\n", (double)(t3 - t2) / (N * LOOPS));
+	(void)sink;
+}
+
+/**
+  * @brief  The application entry point.
+  * @retval int
+  */
+/* Simulated log flash, programming only clears bits */
+#define SIM_LOG_BLOCK			4096
+#define SIM_LOG_BLOCKS			64
+
+typedef struct
+{
+	uint32_t		Stamp;
+	uint16_t		Channel;
+	int16_t			Raw;
+} Sim_LogSample_t;
+
+typedef struct
+{
+	const Sim_LogSample_t *Ref;			/* Expected samples, NULL = print */
+	uint32_t		Idx;
+	uint32_t		Mismatch;
+	uint32_t		Seq;
+} Sim_LogCheck_t;
+
+static uint8_t LogFlash[SIM_LOG_BLOCKS * SIM_LOG_BLOCK] __ALIGNED(4);
+static uint32_t LogErases[SIM_LOG_BLOCKS];
+static uint32_t LogReprogram;
+static DS18B20_LogChan_t LogChan[0x10000];
+
+/**
+  * @brief  The internal function is used to read the log flash
+  * @retval OK = 1, Out of range = 0
+  */
+static uint8_t Sim_LogRead(DS18B20_Log_t *Log, uint32_t Addr, uint8_t *Data,
+		uint32_t Len)
+{
+	(void)Log;
+	if (Addr + Len > sizeof(LogFlash)) return 0;
+	memcpy(Data, &LogFlash[Addr], Len);
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to program whole units of the log
+  * 		flash, a unit programmed twice is counted
+  * @retval OK = 1, Out of range or unaligned = 0
+  */
+static uint8_t Sim_LogProgram(DS18B20_Log_t *Log, uint32_t Addr,
+		const uint8_t *Data, uint32_t Len)
+{
+	if (Addr + Len > sizeof(LogFlash)) return 0;
+	if ((Addr % Log->Unit) != 0 || (Len % Log->Unit) != 0) return 0;
+
+	for (uint32_t u = 0; u < Len; u += Log->Unit)
+	{
+		for (uint32_t i = 0; i < Log->Unit; i++)
+		{
+			if (LogFlash[Addr + u + i] != 0xFF)
+			{
+				LogReprogram++;
+				break;
+			}
+		}
+	}
+	for (uint32_t i = 0; i < Len; i++)
+	{
+		LogFlash[Addr + i] &= Data[i];
+	}
+	return 1;
+}
+
+/**
+  * @brief  The internal function is used to erase a block of the log flash
+  * @retval OK = 1, Out of range = 0
+  */
+static uint8_t Sim_LogErase(DS18B20_Log_t *Log, uint16_t Block)
+{
+	if (Block >= SIM_LOG_BLOCKS) return 0;
+	memset(&LogFlash[Block * Log->BlockSize], 0xFF, Log->BlockSize);
+	LogErases[Block]++;
+	return 1;
+}
+
+static const DS18B20_LogOps_t Sim_LogOps =
+{
+	Sim_LogRead, Sim_LogProgram, Sim_LogErase
+};
+
+/**
+  * @brief  The internal function is used to check or print a decoded sample
+  */
+static void Sim_LogOut(void *Ctx, uint16_t Channel, uint32_t Stamp,
+		int16_t Raw)
+{
+	Sim_LogCheck_t *C = Ctx;
+	const Sim_LogSample_t *R;
+
+	if (C->Ref == NULL)
+	{
+		printf("%u,%u,%u,%d,%.4f\n", C->Seq, Channel, Stamp, Raw,
+				(double)Raw * 0.0625);
+		return;
+	}
+	R = &C->Ref[C->Idx++];
+	if (R->Channel != Channel || R->Stamp != Stamp || R->Raw != Raw)
+	{
+		C->Mismatch++;
+	}
+}
+
+/**
+  * @brief  The internal function is used to sort blocks by sequence number
+  */
+static int Sim_LogCmp(const void *A, const void *B)
+{
+	uint32_t a = ((const uint32_t *)A)[0], b = ((const uint32_t *)B)[0];
+
+	return (a > b) - (a < b);
+}
+
+/**
+  * @brief  The internal function is used to decode every block of an image,
+  * 		oldest first
+  * @retval Number of samples
+  * @param  Image	Log image
+  * @param  Size	Image size in byte
+  * @param  Block	Block size in byte
+  * @param  C		Check state, NULL Ref counts only
+  * @param  Bad		Pointer to return invalid block count
+  */
+static uint32_t Sim_LogDecodeAll(const uint8_t *Image, uint32_t Size,
+		uint32_t Block, Sim_LogCheck_t *C, uint32_t *Bad)
+{
+	static uint32_t order[0x10000][2];
+	DS18B20_LogHdr_t h;
+	uint32_t cnt = 0, total = 0;
+	int32_t n;
+
+	*Bad = 0;
+	for (uint32_t b = 0; b < Size / Block && cnt < 0x10000; b++)
+	{
+		memcpy(&h, &Image[b * Block], sizeof(h));
+		if (h.Magic != DS18B20_LOG_MAGIC) continue;
+		order[cnt][0] = h.Seq;
+		order[cnt][1] = b;
+		cnt++;
+	}
+	qsort(order, cnt, sizeof(order[0]), Sim_LogCmp);
+
+	for (uint32_t i = 0; i < cnt; i++)
+	{
+		if (C != NULL) C->Seq = order[i][0];
+		n = DS18B20_Log_Decode(&Image[order[i][1] * Block], Block, LogChan,
+				0xFFFF, C ? Sim_LogOut : NULL, C);
+		if (n < 0)
+		{
+			(*Bad)++;
+			continue;
+		}
+		total += n;
+	}
+	return total;
+}
+
+/**
+  * @brief  The internal function is used to log a day of samples on the
+  * 		simulated flash and read them back
+  * @param  S			Samples, 1 s per channel
+  * @param  Cnt			Number of samples
+  * @param  Channels	Number of channels
+  * @param  Unit		Program unit
+  * @param  Flush		Flush after every second
+  */
+static void Sim_LogRun(const Sim_LogSample_t *S, uint32_t Cnt,
+		uint16_t Channels, uint16_t Unit, uint8_t Flush)
+{
+	static DS18B20_Log_t Log, Again;
+	Sim_LogCheck_t chk = { 0 };
+	uint32_t used, kept, bad, emin = 0xFFFFFFFFU, emax = 0, lost = 0;
+	uint64_t t0, t1;
+
+	memset(LogFlash, 0xFF, sizeof(LogFlash));
+	memset(LogErases, 0, sizeof(LogErases));
+	LogReprogram = 0;
+
+	memset(&Log, 0, sizeof(Log));
+	Log.Ops = &Sim_LogOps;
+	Log.BlockSize = SIM_LOG_BLOCK;
+	Log.BlockCnt = SIM_LOG_BLOCKS;
+	Log.Unit = Unit;
+	DS18B20_Log_Mount(&Log, LogChan, Channels);
+
+	t0 = Sim_HostNs();
+	for (uint32_t i = 0; i < Cnt; i++)
+	{
+		if (!DS18B20_Log_Append(&Log, S[i].Channel, S[i].Stamp, S[i].Raw))
+		{
+			lost++;
+		}
+		if (Flush && S[i].Channel == Channels - 1) DS18B20_Log_Flush(&Log);
+	}
+	t1 = Sim_HostNs();
+	used = (Log.Blocks - 1) * SIM_LOG_BLOCK + Log.Pos + Log.Fill;
+	DS18B20_Log_Flush(&Log);
+
+	/* Samples still on flash are the newest ones */
+	kept = Sim_LogDecodeAll(LogFlash, sizeof(LogFlash), SIM_LOG_BLOCK, NULL,
+			&bad);
+	chk.Ref = &S[Cnt - kept];
+	Sim_LogDecodeAll(LogFlash, sizeof(LogFlash), SIM_LOG_BLOCK, &chk, &bad);
+
+	for (uint16_t b = 0; b < SIM_LOG_BLOCKS; b++)
+	{
+		if (LogErases[b] < emin) emin = LogErases[b];
+		if (LogErases[b] > emax) emax = LogErases[b];
+	}
+
+	/* Reset without seal, the open block is sealed at mount */
+	memset(&Again, 0, sizeof(Again));
+	Again.Ops = &Sim_LogOps;
+	Again.BlockSize = SIM_LOG_BLOCK;
+	Again.BlockCnt = SIM_LOG_BLOCKS;
+	Again.Unit = Unit;
+	DS18B20_Log_Mount(&Again, LogChan, Channels);
+
+	printf("  %4u %5s %12.2f %6.1fx %10.1f %7u %7u-%-6u %8u %8u %8s\n",
+			Unit, Flush ? "1 s" : "block", (double)used / Cnt,
+			8.0 * Cnt / used, (double)(t1 - t0) / Cnt, Log.Blocks, emin,
+			emax, kept, chk.Mismatch + lost + LogReprogram + bad,
+			(Sim_LogDecodeAll(LogFlash, sizeof(LogFlash), SIM_LOG_BLOCK, NULL,
+			&bad) == kept && bad == 0 && Again.Seq == Log.Seq) ? "ok" :
+			"failed");
+}
+
+/**
+  * @brief  The internal function is used to benchmark the flash log, bytes
+  * 		per sample and encode time against a float and a tick per sample
+  * @param  Channels	Number of channels
+  * @param  Hours		Hours at one sample per second and channel
+  * @param  Image		File the last image is written to, NULL = none
+  */
+static void Sim_BenchLog(uint16_t Channels, uint32_t Hours, const char *Image)
+{
+	uint32_t cnt = (uint32_t)Channels * Hours * 3600U;
+	Sim_LogSample_t *s = malloc(cnt * sizeof(*s));
+	int16_t raw[Channels];
+	uint32_t seed = 1, r, i = 0;
+	FILE *f;
+
+	if (s == NULL || cnt == 0)
+	{
+		free(s);
+		return;
+	}
+
+	/* Probes 0.5 degree apart drifting by 1/16 degree, read 12 ms apart
+	 * with a few ms of jitter */
+	for (uint16_t c = 0; c < Channels; c++) raw[c] = 20 * 16 + (c % 32) * 8;
+	for (uint32_t t = 0; t < Hours * 3600U; t++)
+	{
+		for (uint16_t c = 0; c < Channels; c++)
+		{
+			seed = seed * 1103515245U + 12345U;
+			r = (seed >> 16) % 10;
+			if (r < 2) raw[c]--;
+			if (r >= 8) raw[c]++;
+			s[i].Channel = c;
+			s[i].Raw = raw[c];
+			s[i].Stamp = t * 1000U + c * 12U + (seed >> 8) % 5;
+			i++;
+		}
+	}
+
+	printf("log %u channels, %u h at 1 s, %u blocks of %u byte, float +"
+			" tick = 8 byte/sample\n", Channels, Hours, SIM_LOG_BLOCKS,
+			SIM_LOG_BLOCK);
+	printf("  %4s %5s %12s %7s %10s %7s %13s %8s %8s %8s\n", "unit", "flush",
+			"byte/sample", "ratio", "ns/sample", "blocks", "erases", "kept",
+			"errors", "remount");
+	Sim_LogRun(s, cnt, Channels, 1, 0);
+	Sim_LogRun(s, cnt, Channels, 32, 1);
+	Sim_LogRun(s, cnt, Channels, 32, 0);
+	free(s);
+
+	if (Image == NULL) return;
+	f = fopen(Image, "wb");
+	if (f == NULL) return;
+	fwrite(LogFlash, 1, sizeof(LogFlash), f);
+	fclose(f);
+}
+
+/**
+  * @brief  The internal function is used to print a log image as CSV
+  * @param  Image	Image file
+  * @param  Block	Block size in byte
+  */
+static void Sim_DecodeLog(const char *Image, uint32_t Block)
+{
+	Sim_LogCheck_t chk = { 0 };
+	uint8_t *buf;
+	uint32_t size, cnt, bad;
+	FILE *f = fopen(Image, "rb");
+
+	if (f == NULL || Block == 0) return;
+	fseek(f, 0, SEEK_END);
+	size = (uint32_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(size + 4);
+	if (buf != NULL && fread(buf, 1, size, f) == size)
+	{
+		printf("block,channel,tick,raw,celsius\n");
+		cnt = Sim_LogDecodeAll(buf, size - size % Block, Block, &chk, &bad);
+		fprintf(stderr, "%u samples, %u invalid blocks\n", cnt, bad);
+	}
+	free(buf);
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint16_t def[] = { 2, 20, 200 };
+	int first = 1;
+
+	if (argc > 1 && !strcmp(argv[1], "-c"))
+	{
+		Sim_BenchCRC();
+		return 0;
+	}
+	if (argc > 1 && !strcmp(argv[1], "-l"))
+	{
+		Sim_BenchLog((argc > 2) ? (uint16_t)atoi(argv[2]) : 16,
+				(argc > 3) ? (uint32_t)atoi(argv[3]) : 24,
+				(argc > 4) ? argv[4] : NULL);
+		return 0;
+	}
+	if (argc > 2 && !strcmp(argv[1], "-d"))
+	{
+		Sim_DecodeLog(argv[2], (argc > 3) ? (uint32_t)atoi(argv[3]) :
+				SIM_LOG_BLOCK);
+		return 0;
+	}
+	if (argc > 2 && !strcmp(argv[1], "-b"))
+	{
+		Driver = argv[2];
+		first = 3;
+	}
+
+	printf("driver %s\n", Driver);
+	printf("%7s  %-22s %6s %14s %12s %14s %8s %10s\n", "devices", "call",
+			"calls", "bus us", "us/call", "cpu us", "resets", "slots");
+
+	for (int i = first; i < argc || (argc <= first &&
+			i - first < (int)(sizeof(def) / sizeof(def[0]))); i++)
+	{
+		uint16_t cnt = (argc <= first) ? def[i - first] :
+				(uint16_t)atoi(argv[i]);
+
+		if (!strcmp(Driver, "port"))
+		{
+			Sim_ProfilePort(cnt);
+		} else {
+			Sim_Profile(cnt);
+		}
+	}
+	return Failed ? 1 : 0;
+}